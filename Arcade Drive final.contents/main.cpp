@@ -1,4 +1,10 @@
 #include "robot-config.h"
+#include <atomic>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 /* Define additional digital outputs.
  * Follow this format:
@@ -10,41 +16,376 @@
  */
 //Creates a competition object that allows access to Competition methods.
 //vex::competition    Competition;
+/**
+ * A value shared between tasks without locking: it is published under a
+ * sequence counter that is odd while a write is in progress, and read()
+ * retries if the counter changed during the read. Only one task may write
+ * each Seqlock; any task may read it.
+ */
+template <typename T> struct Seqlock {
+    std::atomic<unsigned> seq;
+    T data;
+    
+    void write(const T &value) {
+        seq.fetch_add(1, std::memory_order_relaxed);  // odd - write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        data = value;
+        seq.fetch_add(1, std::memory_order_release);
+    }
+    
+    T read() const {
+        T value;
+        unsigned before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            value = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        return value;
+    }
+};
+
+/**
+ * Loop timing. Each stage of the driver control loop is timed by a StageTimer,
+ * which adds the microseconds to that stage's histogram when it goes out of
+ * scope (or when next() moves it on to the following stage). Histograms have
+ * fixed buckets and nothing allocates, so a timing costs two reads of the
+ * microsecond timer and a few additions. The tick to tick period of the loop
+ * has a histogram of its own.
+ *
+ * Two sets are kept: totals since the program started, which the telemetry
+ * task writes to a text file next to the log, and a LOOP_STATS_MS window for
+ * the brain screen. Each task that times something keeps its own TaskTiming
+ * and is the only task that writes it. The others see copies it publishes
+ * through Seqlocks: driver control passes each window to the UI task in the
+ * UiState snapshot and its totals to the telemetry task, and the UI task
+ * publishes the screen stage's totals.
+ */
+enum TimingStage {
+    STAGE_INPUT,      // joystick reads
+    STAGE_RECORD,     // routine recording
+    STAGE_CURVE,      // joystick curve
+    STAGE_MIX,        // arcade mixing
+    STAGE_MOTORS,     // spin_motors()
+    STAGE_LOG,        // telemetry record
+    STAGE_PUBLISH,    // UI snapshot
+    STAGE_TICK,       // the whole tick, all of the above
+    STAGE_SCREEN,     // drawing, in the UI task
+    NUM_STAGES
+};
+const char *const stage_names[NUM_STAGES] = {"input", "record", "curve", "mix", "motors",
+                                             "log", "publish", "tick", "screen"};
+const int TIMING_BUCKETS = 12;   // stages: < 1 us, < 2 us, < 4 us, ... < 1024 us, 1024 us and over
+                                 // period: 0 ms, 1 ms, ... 10 ms, 11 ms and over
+const int LOOP_STATS_MS = 1000;  // the brain screen shows timing over this window
+const int TIMING_DUMP_MS = 10000;
+
+struct Histogram {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    double total_sq;  // us^2, for the standard deviation
+    uint32_t buckets[TIMING_BUCKETS];
+};
+
+// Over one window; no buckets, to keep the UI snapshot small
+struct TimingWindow {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t total_us;
+    double total_sq;
+};
+
+struct LoopStats {
+    TimingWindow stage[NUM_STAGES];
+    TimingWindow period;
+};
+
+struct TimingTotals {
+    Histogram stage[NUM_STAGES];
+    Histogram period;
+};
+
+// One task's timings, written only by that task
+struct TaskTiming {
+    TimingTotals totals;  // since the start
+    LoopStats window;     // in progress
+};
+
+static TaskTiming drive_timing;   // driver control (and routine playback, which runs in its place)
+static TaskTiming screen_timing;  // the UI task; STAGE_SCREEN only
+static LoopStats last_loop_stats;    // driver control's last complete window
+static uint32_t loop_windows = 0;
+static Seqlock<TimingTotals> drive_timing_totals;  // every LOOP_STATS_MS, for the telemetry task
+static Seqlock<Histogram> screen_timing_totals;    // every UI pass
+
+int durationBucket(uint32_t us) {
+    int b = 0;
+    while (us > 0 && b < TIMING_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+int periodBucket(uint32_t us) { return us / 1000 < (uint32_t)TIMING_BUCKETS ? us / 1000 : TIMING_BUCKETS - 1; }
+
+void timingAdd(Histogram &h, TimingWindow &w, uint32_t us, int bucket) {
+    h.count++;
+    h.total_us += us;
+    h.total_sq += (double)us * us;
+    if (us > h.max_us) h.max_us = us;
+    h.buckets[bucket]++;
+    w.count++;
+    w.total_us += us;
+    w.total_sq += (double)us * us;
+    if (us > w.max_us) w.max_us = us;
+}
+
+void stageAdd(TaskTiming &timing, TimingStage stage, uint32_t us) {
+    timingAdd(timing.totals.stage[stage], timing.window.stage[stage], us, durationBucket(us));
+}
+
+// Standard deviation, us
+double timingJitter(uint32_t count, double total_us, double total_sq) {
+    if (count == 0) return 0.;
+    double mean = total_us / count;
+    return sqrt(fmax(0., total_sq / count - mean * mean));
+}
+
+class StageTimer {
+public:
+    explicit StageTimer(TimingStage stage, TaskTiming &timing = drive_timing)
+        : timing(timing), stage(stage), start(vex::timer::systemHighResolution()) {}
+    ~StageTimer() { stageAdd(timing, stage, (uint32_t)(vex::timer::systemHighResolution() - start)); }
+
+    // End this stage and start timing the next
+    void next(TimingStage following) {
+        uint64_t now = vex::timer::systemHighResolution();
+        stageAdd(timing, stage, (uint32_t)(now - start));
+        stage = following;
+        start = now;
+    }
+
+private:
+    TaskTiming &timing;
+    TimingStage stage;
+    uint64_t start;
+};
+
+/**
+ * Write the totals since the start as text, one line per stage with its
+ * bucket counts, then the loop period.
+ */
+int timingReport(const TimingTotals &t, char *buf, int size) {
+    int n = snprintf(buf, size, "stage       count   avg us   max us  buckets <1 <2 <4 .. <1024 >=1024 us\n");
+    for (int s = 0; s < NUM_STAGES && n < size; s++) {
+        const Histogram &h = t.stage[s];
+        n += snprintf(buf + n, size - n, "%-9s %7lu %8.1f %8lu ", stage_names[s], (unsigned long)h.count,
+                      h.count ? (double)h.total_us / h.count : 0., (unsigned long)h.max_us);
+        for (int b = 0; b < TIMING_BUCKETS && n < size; b++) {
+            n += snprintf(buf + n, size - n, " %lu", (unsigned long)h.buckets[b]);
+        }
+        if (n < size) n += snprintf(buf + n, size - n, "\n");
+    }
+    const Histogram &p = t.period;
+    if (n < size) {
+        n += snprintf(buf + n, size - n, "period    %7lu %8.1f %8lu  jitter %.1f us, buckets 0 1 2 .. 10 >=11 ms\n         ",
+                      (unsigned long)p.count, p.count ? (double)p.total_us / p.count : 0., (unsigned long)p.max_us,
+                      timingJitter(p.count, (double)p.total_us, p.total_sq));
+    }
+    for (int b = 0; b < TIMING_BUCKETS && n < size; b++) {
+        n += snprintf(buf + n, size - n, " %lu", (unsigned long)p.buckets[b]);
+    }
+    if (n < size) n += snprintf(buf + n, size - n, "\n");
+    return n < size ? n : size - 1;
+}
+
 /* Controller screen lines, if 0, do not print */
 const int JOYSTICK_LINE = 1;
 const int MOTOR_LINE = 2;
 const int SPINNER_LINE = 3;
 
+/**
+ * Controller screen. Everything printed to the controller goes over the radio
+ * link that also carries the joysticks, and the controller drops writes that
+ * come too quickly, so nothing prints to Controller1.Screen directly.
+ * controllerPrint() only changes screen_wanted, our copy of what the screen
+ * should show; the UI task (ui_loop()) compares it with screen_shown, what
+ * the screen does show, and sends the changed part of one line at a time
+ * within CONTROLLER_SCREEN_BYTES_PER_S. A line that changes again before it
+ * is sent goes out once, with its newest text. Lines take turns, so one that
+ * changes all the time (the joystick line) cannot hold up the others.
+ */
+const int SCREEN_ROWS = 3;
+const int SCREEN_COLS = 19;
+const int CONTROLLER_SCREEN_BYTES_PER_S = 300;
+const int SCREEN_WRITE_OVERHEAD = 8;  // bytes a write costs besides its text, estimated
+const int UI_PERIOD_MS = 50;          // at most one write per period
+
+static char screen_wanted[SCREEN_ROWS][SCREEN_COLS];
+static char screen_shown[SCREEN_ROWS][SCREEN_COLS];
+static double screen_budget = 0.;  // bytes that may be sent now
+static int screen_next_row = 0;    // whose turn it is
+
+// Set what a controller screen line (1 to SCREEN_ROWS) should show, printf style
+void controllerPrint(int line, const char *format, ...) {
+    if (line < 1 || line > SCREEN_ROWS) return;
+    char text[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    int len = (int)strlen(text);
+    for (int c = 0; c < SCREEN_COLS; c++) screen_wanted[line - 1][c] = c < len ? text[c] : ' ';
+}
+
+// Clear the controller screen now; call before the screen task starts
+void controllerScreenClear() {
+    Controller1.Screen.clearScreen();
+    memset(screen_wanted, ' ', sizeof(screen_wanted));
+    memset(screen_shown, ' ', sizeof(screen_shown));
+}
+
+/**
+ * Send the changed part of the next line that has one, if the budget allows.
+ * @return bytes sent, 0 if nothing was
+ */
+int controllerScreenFlush() {
+    for (int k = 0; k < SCREEN_ROWS; k++) {
+        int row = (screen_next_row + k) % SCREEN_ROWS;
+        const char *want = screen_wanted[row];
+        char *shown = screen_shown[row];
+        int first = 0;
+        while (first < SCREEN_COLS && want[first] == shown[first]) first++;
+        if (first == SCREEN_COLS) continue;
+        int last = SCREEN_COLS - 1;
+        while (want[last] == shown[last]) last--;
+        int len = last - first + 1;
+        int cost = SCREEN_WRITE_OVERHEAD + len;
+        if (cost > screen_budget) return 0;  // this line keeps its turn
+        Controller1.Screen.setCursor(row + 1, first + 1);
+        Controller1.Screen.print("%.*s", len, want + first);
+        memcpy(shown + first, want + first, len);
+        screen_budget -= cost;
+        screen_next_row = (row + 1) % SCREEN_ROWS;
+        return cost;
+    }
+    return 0;
+}
+
+// Add a UI period's worth of budget, up to one full line
+void controllerScreenRefill() {
+    const double burst = SCREEN_WRITE_OVERHEAD + SCREEN_COLS;
+    screen_budget = fmin(burst, screen_budget + CONTROLLER_SCREEN_BYTES_PER_S * UI_PERIOD_MS / 1000.);
+}
+
 /* Joystick rescaling - input^(1+smooth_power) outside the dead zone */
-const double DEADZONE = 0.02;
+const double DEADZONE = 0.02;  // default, the tunables file can change deadzone
 const double JOY_SCALE = 127.0;
-static double smooth_power = 0.55;
-const double smooth_power_step = 0.05;
-const double MAX_SMOOTH_POWER = 1.0;
-const double MIN_SMOOTH_POWER = -0.75;
+constexpr double smooth_power_step = 0.05;
+constexpr double MAX_SMOOTH_POWER = 1.0;
+constexpr double MIN_SMOOTH_POWER = -0.75;
+
+/* Joystick response presets, one per smooth_power step from MIN_SMOOTH_POWER to
+ * MAX_SMOOTH_POWER. Each table samples t^(1+smooth_power) at CURVE_STEPS+1 points,
+ * t = (input - deadzone) / (1 - deadzone) from 0 to 1. All tables are generated
+ * by the compiler, so the robot does no pow() at startup or while driving, and
+ * changing smooth_power only changes which table curve_table points to. */
+const int CURVE_STEPS = 1024;
+constexpr int NUM_CURVE_PRESETS = (int)((MAX_SMOOTH_POWER - MIN_SMOOTH_POWER) / smooth_power_step + 0.5) + 1;
+static_assert(MIN_SMOOTH_POWER + (NUM_CURVE_PRESETS - 1) * smooth_power_step > MAX_SMOOTH_POWER - 1e-9 &&
+              MIN_SMOOTH_POWER + (NUM_CURVE_PRESETS - 1) * smooth_power_step < MAX_SMOOTH_POWER + 1e-9,
+              "the smooth_power steps must land on MAX_SMOOTH_POWER");
+
+// Compile-time math: ln() by halving into [0.5, 1] plus the atanh series,
+// exp() by squaring from a short Taylor series.
+constexpr double LN2 = 0.693147180559945309;
+constexpr double ct_atanh_series(double z2, double zk, int k) {
+    return k > 41 ? 0. : zk / k + ct_atanh_series(z2, zk * z2, k + 2);
+}
+constexpr double ct_atanh(double z) { return ct_atanh_series(z * z, z, 1); }
+constexpr double ct_ln(double x) {
+    return x < 0.5 ? ct_ln(2. * x) - LN2 : 2. * ct_atanh((x - 1.) / (x + 1.));
+}
+constexpr double ct_exp_taylor(double y, double term, int k) {
+    return k > 20 ? term : term + ct_exp_taylor(y, term * y / k, k + 1);
+}
+constexpr double ct_square(double x) { return x * x; }
+constexpr double ct_exp(double y) {
+    return (y < -0.25 || y > 0.25) ? ct_square(ct_exp(y / 2.)) : ct_exp_taylor(y, 1., 1);
+}
+constexpr float curve_point(int i, int preset) {
+    return i == 0 ? 0.f
+                  : (float)ct_exp((1. + MIN_SMOOTH_POWER + preset * smooth_power_step) * ct_ln((double)i / CURVE_STEPS));
+}
+
+// index_list<0, 1, ..., N-1>, built by doubling to keep template depth low
+template <int... Is> struct index_list {};
+template <class L, int H, bool Odd> struct double_index_list;
+template <int... Is, int H> struct double_index_list<index_list<Is...>, H, false> {
+    typedef index_list<Is..., (H + Is)...> type;
+};
+template <int... Is, int H> struct double_index_list<index_list<Is...>, H, true> {
+    typedef index_list<Is..., (H + Is)..., 2 * H> type;
+};
+template <int N> struct make_index_list {
+    typedef typename double_index_list<typename make_index_list<N / 2>::type, N / 2, N % 2 == 1>::type type;
+};
+template <> struct make_index_list<0> { typedef index_list<> type; };
+
+struct CurveTable { float v[CURVE_STEPS + 1]; };
+
+template <int... Is> constexpr CurveTable make_curve_table(int preset, index_list<Is...>) {
+    return CurveTable{{ curve_point(Is, preset)... }};
+}
+// One constant per preset, so each table is a separate (smaller) compile-time evaluation
+template <int P> struct CurvePreset {
+    static constexpr CurveTable table = make_curve_table(P, make_index_list<CURVE_STEPS + 1>::type());
+};
+template <int P> constexpr CurveTable CurvePreset<P>::table;
+
+template <int... Ps> struct CurvePresetList {
+    static const float *const table[sizeof...(Ps)];
+};
+template <int... Ps> const float *const CurvePresetList<Ps...>::table[sizeof...(Ps)] = { CurvePreset<Ps>::table.v... };
+
+template <class L> struct CurvePresetsOf;
+template <int... Ps> struct CurvePresetsOf<index_list<Ps...> > { typedef CurvePresetList<Ps...> type; };
+typedef CurvePresetsOf<make_index_list<NUM_CURVE_PRESETS>::type>::type curve_presets;
+
+static int curve_preset = 26;  // smooth_power = 0.55
+static double smooth_power = MIN_SMOOTH_POWER + curve_preset * smooth_power_step;
+static const float *curve_table = curve_presets::table[curve_preset];
+static double deadzone = DEADZONE;
+// Set when the driver changes a tunable; driver control passes the values on to be saved
+static std::atomic<bool> tunables_changed(false);
 
 double scale_joystick(double input)  // input positive between 0 and ~ 1
 {
-    // result ~= input^(1+smooth_power), modulo dead zone
-	double result;
-	if (input > DEADZONE) {
-		result = fmin((input - DEADZONE) / (1.0 - DEADZONE), 1.0);
-		result *= pow(result, smooth_power);  // fine control, optional
-	}
-    else {
-        return 0.;
-    }
-	return result;
+    if (input <= deadzone) return 0.;
+    if (input >= 1.0) return curve_table[CURVE_STEPS];
+    // linear interpolation between the two nearest table entries
+    double x = (input - deadzone) / (1.0 - deadzone) * CURVE_STEPS;
+    int i = (int)x;
+    return curve_table[i] + (curve_table[i + 1] - curve_table[i]) * (x - i);
+}
+
+void set_curve_preset(int preset) {
+    curve_preset = preset < 0 ? 0 : (preset >= NUM_CURVE_PRESETS ? NUM_CURVE_PRESETS - 1 : preset);
+    smooth_power = MIN_SMOOTH_POWER + curve_preset * smooth_power_step;
+    curve_table = curve_presets::table[curve_preset];
 }
 
 void smooth_power_up() {
-    smooth_power += smooth_power_step;
-    smooth_power = fmin(smooth_power, MAX_SMOOTH_POWER);
+    set_curve_preset(curve_preset + 1);
+    tunables_changed = true;
 }
 
 void smooth_power_down() {
-    smooth_power -= smooth_power_step;
-    smooth_power = fmax(smooth_power, MIN_SMOOTH_POWER);
+    set_curve_preset(curve_preset - 1);
+    tunables_changed = true;
 }
 
 // Whether to print drive info on controller screen
@@ -52,20 +393,88 @@ void smooth_power_down() {
 static bool print_info = true;
 
 void toggle_print_info(){
-    print_info = !print_info;
-    if (!print_info) {
-        // turned off; clear stale info
-        if (JOYSTICK_LINE > 0) Controller1.Screen.clearLine(JOYSTICK_LINE);
-        if (MOTOR_LINE > 0) Controller1.Screen.clearLine(MOTOR_LINE);
-    }
+    print_info = !print_info;  // the UI task clears the info lines when it is off
 }
 
 
 // Drive code
-motor lmotors[] {Motor11dl, Motor01dl, Motor03dl};
-motor rmotors[] {Motor04dr, Motor16dr, Motor02dr};
 const int NUM_MOTORS = 3; // per side
 
+/**
+ * Motors that are driven together, e.g. one side of the drive. Holds pointers to
+ * the motors declared in robot-config.h instead of copies, and applies each
+ * command or sensor read to the whole group in one call.
+ */
+class MotorGroup {
+public:
+    MotorGroup(motor &m1, motor &m2, motor &m3) : m{&m1, &m2, &m3} {}
+
+    motor &operator[](int i) { return *m[i]; }
+
+    void spin(directionType dir, double velocity, percentUnits units) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->spin(dir, velocity, units);
+    }
+
+    void spin(directionType dir, double voltage, voltageUnits units) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->spin(dir, voltage, units);
+    }
+
+    void stop() {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->stop();
+    }
+
+    void stop(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->stop(mode);
+    }
+
+    void setStopping(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->setStopping(mode);
+    }
+
+    void resetRotation() {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->resetRotation();
+    }
+
+    // Averages over the group
+    double power() {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->power(powerUnits::watt);
+        return sum / NUM_MOTORS;
+    }
+
+    double velocity(velocityUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->velocity(units);
+        return sum / NUM_MOTORS;
+    }
+
+    double rotation(rotationUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->rotation(units);
+        return sum / NUM_MOTORS;
+    }
+
+    // Total over the group, A
+    double current() {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->current(currentUnits::amp);
+        return sum;
+    }
+
+    // Hottest motor of the group, C
+    double temperature() {
+        double hottest = m[0]->temperature(temperatureUnits::celsius);
+        for (int i = 1; i < NUM_MOTORS; i++) hottest = fmax(hottest, m[i]->temperature(temperatureUnits::celsius));
+        return hottest;
+    }
+
+private:
+    motor *m[NUM_MOTORS];
+};
+
+MotorGroup lmotors(Motor11dl, Motor01dl, Motor03dl);
+MotorGroup rmotors(Motor04dr, Motor16dr, Motor02dr);
+
 /**
  * Reversing of motors. If reversed is true then front and back of the robot are reversed.
  */
@@ -80,41 +489,29 @@ const brakeType stopping_mode[] = {brakeType::coast, brakeType::brake, brakeType
 // Current left/right motor power
 static double cur_lp = 0.;
 static double cur_rp = 0.;
-
-void print_motor_line() {
-    if (print_info && MOTOR_LINE > 0) {
-            // Print motor values for information
-            Controller1.Screen.setCursor(MOTOR_LINE, 1);
-            Controller1.Screen.print("M: %c %c %3.0f%% %3.0f%%     ", (reversed ? 'R' : 'F'), 
-                                     stopping_mode_char[stopping_mode_num], cur_lp, cur_rp);
-        }
-}
+// Joystick values last driven with
+static double cur_px = 0.;
+static double cur_py = 0.;
 
 void spin_motors(double lp, double rp) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(vex::directionType::fwd, lp, percentUnits::pct);
-        rmotors[i].spin(vex::directionType::fwd, rp, percentUnits::pct);
-    }
+    lmotors.spin(vex::directionType::fwd, lp, percentUnits::pct);
+    rmotors.spin(vex::directionType::fwd, rp, percentUnits::pct);
 }
 
 void set_stopping_mode_for_motors(brakeType mode) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].setStopping(mode);
-        rmotors[i].setStopping(mode);
-    }
+    lmotors.setStopping(mode);
+    rmotors.setStopping(mode);
 }
 
 void reverse_toggle() {
     reversed = !reversed;
     spin_motors(0., 0.);  // momentarily slow down to 0, so as not be too abrupt 
-    print_motor_line();
     Controller1.rumble(".=");
 }
 
 void stopping_mode_toggle() {
     ++stopping_mode_num %= 3;  // same as stopping_mode_num = (stopping_mode_num + 1) % 3;
     set_stopping_mode_for_motors(stopping_mode[stopping_mode_num]);
-    print_motor_line();
     Controller1.rumble("..");
 }
 
@@ -122,25 +519,25 @@ void stopping_mode_toggle() {
  * Stop all wheel motors 
  */
 void stopAllMotors() {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].stop();
-        rmotors[i].stop();
-    }
+    lmotors.stop();
+    rmotors.stop();
 }
 
-void arcadedrive() {
+/**
+ * Drive from joystick values.
+ * @param px, py     Controller1.Axis1 and Axis2 values, -127 to 127
+ * @param ltrim=0    Added to the left/right motor power, % (used by playback)
+ * @param rtrim=0
+ */
+void arcadedrive(double px, double py, double ltrim=0., double rtrim=0.) {
     
-    double px = Controller1.Axis1.value();  //Gets the value of the joystick axis on a scale from -127 to 127.
-    double py = Controller1.Axis2.value();
-        
+    
+    StageTimer timer(STAGE_CURVE);
     double d = sqrt(px*px + py*py) / JOY_SCALE; // distance from the origin, 0 to ~ 1
     double scale = scale_joystick(d);  // rescale that distance
-    
-    if (print_info && JOYSTICK_LINE > 0) {
-        // Print joystick and scaling values for information
-        Controller1.Screen.setCursor(JOYSTICK_LINE, 1);
-        Controller1.Screen.print("J %4.0f %4.0f %3.2f   ", py, px, smooth_power);
-    }
+    timer.next(STAGE_MIX);
+    cur_px = px;
+    cur_py = py;
     
     if(py < 0) {
         px *= -1;
@@ -153,8 +550,8 @@ void arcadedrive() {
     py *= scale / JOY_SCALE;
 
     // tentative left/right motor power
-    double lp = py + px;  // from 0 to ~2
-    double rp = py - px;
+    double lp = py + px + ltrim / 100;  // from 0 to ~2
+    double rp = py - px + rtrim / 100;
 
     // if |motor power| > 1, rescale them both 
     double mapow = fmax(fabs(lp), fabs(rp));
@@ -166,11 +563,11 @@ void arcadedrive() {
     lp *= 100; // turn into percent, for motor input
     rp *= 100;
     
+    timer.next(STAGE_MOTORS);
     if (lp != cur_lp || rp != cur_rp) {  //   
         spin_motors(lp, rp);
         cur_lp = lp;
         cur_rp = rp;
-        print_motor_line();
     }
     
 }
@@ -182,39 +579,147 @@ void arcadedrive() {
 // States sycle 0-1-2-3-4-0-... with button press.
 static int spinner_state = 0;
 static double spinner_rpm = 500.;
-const double spinner_rpm_mult = 1.05; 
+static double spinner_rpm_mult = 1.05;
+const double SPINNER_MAX_RPM = 600.;  // ratio6_1 free speed; spinner_rpm stays in (0, SPINNER_MAX_RPM]
 
-void print_spin() {
-    if (SPINNER_LINE <= 0) return;  // do nothing
-    Controller1.Screen.setCursor(SPINNER_LINE, 1);
-    Controller1.Screen.print("S: %s rpm %5.0f   ", (spinner_state % 2 == 0 ? "OFF": (spinner_state == 1 ? "FWD" : "REV")),
-                                                    spinner_rpm); 
-}
+/**
+ * Spinner speed control. Left to the motor's own velocity control, the spinner
+ * slows down a lot when a game object loads it and is slow to come back, so a
+ * task of ours sets the motor voltage every SPIN_PERIOD_MS instead:
+ * feedforward for spinner_rpm, which does nearly all the work, plus
+ * proportional and integral feedback on the speed error, which only have to
+ * make up for the load. spinner_ready is set once the speed has stayed within
+ * SPIN_READY_RPM of the target for SPIN_READY_MS, and cleared by any change;
+ * the controller's spinner line shows it as RDY.
+ */
+const int SPIN_PERIOD_MS = 5;
+const double SPIN_VOLTS = 12.;
+const double SPIN_KS = 0.1;                // V, friction
+const double SPIN_KV = SPIN_VOLTS / SPINNER_MAX_RPM;  // V per rpm
+const double SPIN_KP = 0.12;               // V per rpm of error; more reacts faster in the
+                                           // simulator but amplifies the motor's velocity noise
+const double SPIN_KI = 3.;                 // V per rpm per second of error
+const double SPIN_READY_RPM = 15.;
+const int SPIN_READY_MS = 100;
 
+static double spin_integral = 0.;  // V
+static bool spinner_ready = false;
+static int spin_ready_ms = 0;      // how long the speed has been within SPIN_READY_RPM
+
+/**
+ * Jam protection, run by spinner_loop() alongside the speed control. The
+ * spinner counts as jammed when, after JAM_GRACE_MS to spin up, it turns
+ * slower than JAM_SPEED_FRACTION of spinner_rpm while drawing more than
+ * JAM_AMPS for JAM_DETECT_MS. It then runs backwards for JAM_REVERSE_MS and
+ * goes back to what it was doing. It backs out JAM_MAX_RETRIES times; if it
+ * jams again without getting back up to speed in between, it gives up and
+ * turns the spinner off, so a stuck object does not burn out the motor. Jams are counted in spinner_jams
+ * and shown on the brain screen (by the UI task) for after the match.
+ */
+const double JAM_SPEED_FRACTION = 0.2;
+const double JAM_AMPS = 1.5;           // stall is 2.5 A
+const int JAM_GRACE_MS = 200;
+const int JAM_DETECT_MS = 30;
+const double JAM_REVERSE_VOLTS = 8.;
+const int JAM_REVERSE_MS = 250;
+const int JAM_MAX_RETRIES = 3;        // back-outs before the next jam gives up
+
+static int spinner_jams = 0;    // since the program started
+static double last_jam_ms = 0.;
+static int spin_run_ms = 0;     // since the spinner started or came out of a reverse
+static int jam_ms = 0;          // how long it has looked jammed
+static int unjam_ms_left = 0;   // reversing while > 0
+static int jam_retries = 0;     // jams since the spinner was last up to speed
+
+// Call after changing spinner_state or spinner_rpm; spinner_loop() does the rest
 void set_spin() {
+    spinner_ready = false;
+    spin_ready_ms = 0;
+    spin_run_ms = jam_ms = unjam_ms_left = jam_retries = 0;
     if (spinner_state % 2 == 0) { // states 0 and 2
+        spin_integral = 0.;
         Motor05sp.stop(brakeType::coast);        
-    } else {
-        Motor05sp.spin((spinner_state == 1 ? directionType::fwd : directionType::rev), spinner_rpm, velocityUnits::rpm);
     }
 }
 
+// One speed control step towards target rpm; returns the speed error
+double spinControlStep(double target) {
+    double err = target - Motor05sp.velocity(velocityUnits::rpm);
+    double volts = SPIN_KS * (target > 0 ? 1 : -1) + SPIN_KV * target + SPIN_KP * err + spin_integral;
+    // integrate only while that can still help, so a stall does not wind it up
+    if (fabs(volts) < SPIN_VOLTS || volts * err < 0) spin_integral += SPIN_KI * err * SPIN_PERIOD_MS / 1000.;
+    volts = fmax(-SPIN_VOLTS, fmin(SPIN_VOLTS, volts));
+    Motor05sp.spin(directionType::fwd, volts, voltageUnits::volt);
+    return err;
+}
+
+// Watch for a jam while spinning towards target rpm; true when one is found
+bool jamDetected(double target) {
+    spin_run_ms += SPIN_PERIOD_MS;
+    bool stalled = spin_run_ms > JAM_GRACE_MS &&
+                   fabs(Motor05sp.velocity(velocityUnits::rpm)) < JAM_SPEED_FRACTION * fabs(target) &&
+                   Motor05sp.current(currentUnits::amp) > JAM_AMPS;
+    jam_ms = stalled ? jam_ms + SPIN_PERIOD_MS : 0;
+    return jam_ms >= JAM_DETECT_MS;
+}
+
+int spinner_loop() {
+    while (true) {
+        if (spinner_state % 2 == 1) {
+            double target = spinner_state == 1 ? spinner_rpm : -spinner_rpm;
+            if (unjam_ms_left > 0) {
+                Motor05sp.spin(directionType::fwd, target > 0 ? -JAM_REVERSE_VOLTS : JAM_REVERSE_VOLTS, voltageUnits::volt);
+                unjam_ms_left -= SPIN_PERIOD_MS;
+                if (unjam_ms_left <= 0) {
+                    spin_integral = 0.;
+                    spin_run_ms = 0;
+                }
+            } else if (jamDetected(target)) {
+                spinner_jams++;
+                last_jam_ms = Brain.timer(timeUnits::msec);
+                jam_ms = 0;
+                spinner_ready = false;
+                spin_ready_ms = 0;
+                if (++jam_retries > JAM_MAX_RETRIES) {
+                    spinner_state = 0;  // still stuck, give up
+                    set_spin();
+                    Controller1.rumble("---");
+                } else {
+                    unjam_ms_left = JAM_REVERSE_MS;
+                    Controller1.rumble(".");
+                }
+            } else {
+                double err = spinControlStep(target);
+                spin_ready_ms = fabs(err) < SPIN_READY_RPM ? spin_ready_ms + SPIN_PERIOD_MS : 0;
+                bool ready = spin_ready_ms >= SPIN_READY_MS;
+                if (ready) jam_retries = 0;
+                spinner_ready = ready;
+            }
+        }
+        task::sleep(SPIN_PERIOD_MS);
+    }
+    return 0;
+}
+
+void start_spinner_control() {
+    static vex::task spinner(spinner_loop, vex::task::taskPriorityHigh);
+}
+
 void spinner_toggle() {
     ++spinner_state %= 4;  // same as spinner_state = (spinner_state + 1) % 4;
     set_spin();
-    print_spin();
 }
 
 void spinner_rpm_up() {
-    spinner_rpm *= spinner_rpm_mult;
+    spinner_rpm = fmin(SPINNER_MAX_RPM, spinner_rpm * spinner_rpm_mult);
+    tunables_changed = true;
     set_spin();
-    print_spin();
 }
 
 void spinner_rpm_down() {
     spinner_rpm /= spinner_rpm_mult;
+    tunables_changed = true;
     set_spin();
-    print_spin();
 }
 
 /**
@@ -230,77 +735,1545 @@ int autonState = 1;
  */
 void moveStraight (int power=100, bool fwd=true, int time=1000) {
     vex::directionType dir = fwd ? vex::directionType::fwd : vex::directionType::rev;
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dir, power, percentUnits::pct);
-        rmotors[i].spin(dir, power, percentUnits::pct);
-    }
+    lmotors.spin(dir, power, percentUnits::pct);
+    rmotors.spin(dir, power, percentUnits::pct);
     
     task::sleep(time);
     set_stopping_mode_for_motors(hold);
     stopAllMotors();
 }
 
+/* Drive geometry for encoder based moves. Drive motors use the ratio18_1
+ * cartridge (200 rpm) directly on 5" wheels: 200 rpm * pi * 0.127 m = 1.33 m/s,
+ * which matches the ~1.3 m/s measured on the field. */
+const double WHEEL_DIAMETER = 0.127;   // m
+const double WHEEL_GEAR_RATIO = 1.0;   // wheel turns per motor output turn
+const double METERS_PER_DEG = WHEEL_DIAMETER * M_PI * WHEEL_GEAR_RATIO / 360.;
+const double DRIVE_MAX_SPEED = 1.33;   // m/s at 100% power
+
+/* Turning. The heading change is measured from the difference between the right
+ * and left encoder distances. The effective track width comes from the measured
+ * full power turn rate of ~0.36 deg/ms: 2 * 1.33 m/s / 6.28 rad/s = 0.42 m. */
+const double TRACK_WIDTH = 0.42;       // m
+
+// Distance driven by each side, in meters. Moves measure from their start values
+// rather than resetting the encoders, which the odometry task also reads.
+double leftDistance() { return lmotors.rotation(rotationUnits::deg) * METERS_PER_DEG; }
+double rightDistance() { return rmotors.rotation(rotationUnits::deg) * METERS_PER_DEG; }
+
+// Wheel speed of each side, m/s
+double leftSpeed() { return lmotors.velocity(velocityUnits::dps) * METERS_PER_DEG; }
+double rightSpeed() { return rmotors.velocity(velocityUnits::dps) * METERS_PER_DEG; }
+
+/**
+ * Odometry. A background task integrates the left/right encoder distances into
+ * the robot's position on the field every ODOM_PERIOD_MS. x/y are in meters
+ * from where the robot was at startup (or the last setPose()), x pointing
+ * forward at heading 0; theta is in radians and grows with positive rotate() angles.
+ * The odometry task is the only writer of the pose; readers get a consistent
+ * copy through getPose() without locking, through a Seqlock.
+ */
+const int ODOM_PERIOD_MS = 5;
+
+struct Pose {
+    double x;
+    double y;
+    double theta;
+};
+
+static Seqlock<Pose> pose = {{0}, {0., 0., 0.}};          // written by the odometry task
+static Seqlock<Pose> pose_request = {{0}, {0., 0., 0.}};  // the last setPose(), for the odometry task
+static std::atomic<unsigned> pose_requests(0);
+static std::atomic<unsigned> pose_requests_done(0);  // taken up by the odometry task
+
+/**
+ * Start odometry again from p. Returns once the odometry task has taken it up,
+ * within ODOM_PERIOD_MS, so getPose() starts from p from then on. The odometry
+ * task must be running; call from one task at a time.
+ */
+void setPose(const Pose &p) {
+    pose_request.write(p);
+    unsigned n = pose_requests.fetch_add(1, std::memory_order_release) + 1;
+    while (pose_requests_done.load(std::memory_order_acquire) != n) task::sleep(1);
+}
+
+Pose getPose() {
+    return pose.read();
+}
+
+int odometry_loop() {
+    double last_l = leftDistance();
+    double last_r = rightDistance();
+    Pose p = {0., 0., 0.};
+    unsigned applied = 0;  // setPose() calls taken up
+    while (true) {
+        double l = leftDistance();
+        double r = rightDistance();
+        double ds = ((l - last_l) + (r - last_r)) / 2;
+        double dtheta = ((r - last_r) - (l - last_l)) / TRACK_WIDTH;
+        last_l = l;
+        last_r = r;
+        
+        unsigned requested = pose_requests.load(std::memory_order_acquire);
+        if (requested != applied) {
+            p = pose_request.read();
+            applied = requested;
+        } else {
+            double mid = p.theta + dtheta / 2;  // average heading over the step
+            p.x += ds * cos(mid);
+            p.y += ds * sin(mid);
+            p.theta += dtheta;
+        }
+        pose.write(p);
+        pose_requests_done.store(applied, std::memory_order_release);
+        task::sleep(ODOM_PERIOD_MS);
+    }
+    return 0;
+}
+
+void start_odometry() {
+    static vex::task odometry(odometry_loop);
+}
+
+/**
+ * Motion profile - wheel speed setpoints for a move, limited in speed,
+ * acceleration and jerk (an S-curve; PROFILE_MAX_JERK = 0 gives a trapezoid).
+ * Acceleration stays below what the wheels can take without slipping, and the
+ * profile starts braking just in time to reach its end speed at the end of the
+ * move: zero to stop there, or the speed the next move starts with when moves
+ * are chained. Distances are measured along the wheels, so the same limits serve
+ * straight moves and turns.
+ */
+const double PROFILE_MAX_SPEED = 1.2;  // m/s, below DRIVE_MAX_SPEED to leave room for feedback
+const double PROFILE_SPEED_MARGIN = 0.9;  // never plan above this fraction of the measured top speed
+const double PROFILE_MAX_ACCEL = 3.0;  // m/s^2, wheel slip limit
+const double PROFILE_MAX_JERK = 30.;   // m/s^3
+const double PROFILE_MIN_SPEED = 0.05; // m/s, creep speed so the profile always reaches the end
+
+struct MotionProfile {
+    double distance;   // length of the move, m
+    double max_speed;  // m/s
+    double end_speed;  // m/s at the end of the move
+    double pos;        // current setpoint: position, speed and acceleration
+    double vel;
+    double acc;
+};
+
+MotionProfile makeProfile(double distance, double max_speed=PROFILE_MAX_SPEED,
+                          double start_speed=0., double end_speed=0.) {
+    MotionProfile mp = {distance, max_speed, end_speed, 0., start_speed, 0.};
+    return mp;
+}
+
+// Highest speed that can still brake down to end_speed within remaining distance
+double brakingSpeed(double remaining, double end_speed) {
+    double a = PROFILE_MAX_ACCEL;
+    double c = end_speed * end_speed + 2 * a * remaining;
+    if (PROFILE_MAX_JERK <= 0) return sqrt(c);
+    // braking distance (v^2 - end_speed^2) / 2a + v a / 2j, solved for v
+    double k = a * a / PROFILE_MAX_JERK;
+    return fmax(end_speed, (-k + sqrt(k * k + 4 * c)) / 2);
+}
+
+/**
+ * Advance the profile setpoint by dt seconds.
+ * @return false once the setpoint has reached the end of the move
+ */
+bool stepProfile(MotionProfile &mp, double dt) {
+    double remaining = mp.distance - mp.pos;
+    if (remaining <= 0) {
+        mp.pos = mp.distance;
+        mp.vel = mp.end_speed;
+        mp.acc = 0.;
+        return false;
+    }
+    double target = fmin(mp.max_speed, brakingSpeed(remaining, mp.end_speed));
+    double acc = fmax(-PROFILE_MAX_ACCEL, fmin(PROFILE_MAX_ACCEL, (target - mp.vel) / dt));
+    if (PROFILE_MAX_JERK > 0) {
+        double dj = PROFILE_MAX_JERK * dt;
+        acc = fmax(mp.acc - dj, fmin(mp.acc + dj, acc));
+        // never brake later than the braking curve allows
+        if (mp.vel + acc * dt > target && acc > (target - mp.vel) / dt) acc = (target - mp.vel) / dt;
+    }
+    mp.acc = acc;
+    mp.vel = fmax(PROFILE_MIN_SPEED, fmin(mp.max_speed, mp.vel + acc * dt));
+    mp.pos = fmin(mp.distance, mp.pos + mp.vel * dt);
+    return true;
+}
+
+/**
+ * Drive feedforward: the voltage that keeps a wheel at speed v while
+ * accelerating at a, V = ks * sign(v) + kv * v + ka * a. Turning in place has
+ * its own constants, since the wheels scrub sideways. The defaults follow from
+ * the cartridge's free speed; the characterization auton (state 7) measures
+ * the real ones, which change with the battery, the floor and the build.
+ */
+struct DriveFeedforward {
+    double ks;  // V to overcome static friction
+    double kv;  // V per m/s
+    double ka;  // V per m/s^2
+};
+const double MAX_VOLTS = 12.;
+const double DEFAULT_KS = 0.3;
+const double DEFAULT_KA = 0.54;
+static DriveFeedforward drive_ff = {DEFAULT_KS, (MAX_VOLTS - DEFAULT_KS) / DRIVE_MAX_SPEED, DEFAULT_KA};
+static DriveFeedforward turn_ff = {DEFAULT_KS, (MAX_VOLTS - DEFAULT_KS) / DRIVE_MAX_SPEED, DEFAULT_KA};
+
+// Top wheel speed at full voltage, m/s
+double topSpeed(const DriveFeedforward &ff) { return (MAX_VOLTS - ff.ks) / ff.kv; }
+
+// Profile speed for a move at power %, kept below what the drive can still do
+double profileSpeed(const DriveFeedforward &ff, double power) {
+    return fmin(PROFILE_MAX_SPEED, topSpeed(ff) * PROFILE_SPEED_MARGIN) * power / 100.;
+}
+
+// Voltage for a wheel to run at vel while accelerating at acc
+double feedforwardVolts(const DriveFeedforward &ff, double vel, double acc) {
+    double sign = vel > 0 ? 1. : (vel < 0 ? -1. : 0.);
+    return ff.ks * sign + ff.kv * vel + ff.ka * acc;
+}
+
+const double MOVE_TOLERANCE = 0.01;    // m, close enough to the target to stop
+const double MOVE_KP = 36.;            // V per m behind the profile
+const double MOVE_PUSH_VOLTS = 0.9;    // V above ks to push the last bit of the way
+const double MOVE_STRAIGHT_KP = 24.;   // V per m of left/right difference
+const double TURN_TOLERANCE = 1.5;     // deg, close enough to the target heading
+const int MOVE_SETTLE_MS = 40;         // must stay within tolerance this long
+const int MOVE_POLL_MS = 10;
+
+/**
+ * Voltage to follow the profile: feedforward for its speed and acceleration
+ * plus a correction for position error.
+ * @param scale=1  Wheel travel per m of profile, for the wheels of an arc
+ */
+double profileVolts(const DriveFeedforward &ff, const MotionProfile &mp, bool moving, double pos, double scale=1.) {
+    double err = mp.pos - pos;
+    double v = feedforwardVolts(ff, mp.vel * scale, mp.acc * scale) + err * MOVE_KP * scale;
+    if (!moving) {
+        // profile done: push the last bit of the way, hard enough to get past static friction
+        double push = (ff.ks + MOVE_PUSH_VOLTS) * fabs(scale);
+        v = err * scale > 0 ? fmax(v, push) : fmin(v, -push);
+    }
+    return fmax(-MAX_VOLTS, fmin(MAX_VOLTS, v));
+}
+
+void driveVolts(double left, double right) {
+    lmotors.spin(vex::directionType::fwd, left, voltageUnits::volt);
+    rmotors.spin(vex::directionType::fwd, right, voltageUnits::volt);
+}
+
+/**
+ * What the moves need from the drivetrain. Autonomous drives robot_drive, the
+ * motors; host/auton_sweep.cpp passes its drivetrain model, so the sweep ranks
+ * tunables on this same move code.
+ */
+class DriveIO {
+public:
+    virtual double left() = 0;      // wheel travel of each side, m
+    virtual double right() = 0;
+    virtual double speedPct() = 0;  // the faster side's wheel speed, % of top speed
+    virtual double heading() = 0;   // rad, as Pose::theta
+    virtual void volts(double left, double right) = 0;
+    virtual void hold() = 0;        // stop and hold position
+    virtual void wait(int ms) = 0;
+};
+
+class MotorDrive : public DriveIO {
+public:
+    double left() { return leftDistance(); }
+    double right() { return rightDistance(); }
+    double speedPct() {
+        return fmax(fabs(lmotors.velocity(velocityUnits::pct)), fabs(rmotors.velocity(velocityUnits::pct)));
+    }
+    double heading() { return getPose().theta; }
+    void volts(double left, double right) { driveVolts(left, right); }
+    void hold() {
+        set_stopping_mode_for_motors(brakeType::hold);
+        stopAllMotors();
+    }
+    void wait(int ms) { task::sleep(ms); }
+};
+static MotorDrive robot_drive;
+
+// Heading change since the sides were at distances l0/r0, in degrees, positive as in rotate()
+double turnedAngle(DriveIO &io, double l0, double r0) {
+    return ((io.right() - r0) - (io.left() - l0)) / TRACK_WIDTH * 180. / M_PI;
+}
+
 /**
- * Move forward a certain distance
- * @param distance  Distance to move in meters
- * @param fwd=true  Move forward or backwards?
+ * Move forward a certain distance, following a motion profile and measured with
+ * the drive motor encoders. Keeps both sides level.
+ * With an end speed the robot is still moving when this returns, and the next
+ * move is expected to start at that speed; otherwise it stops and holds.
+ * @param io           The drivetrain
+ * @param ff           Its feedforward constants, drive_ff on the robot
+ * @param distance     Distance to move in meters
+ * @param fwd          Move forward or backwards?
+ * @param power        Maximum power
+ * @param start_speed  Speed the robot already has, m/s
+ * @param end_speed    Speed to hand over to the next move, m/s
+ * @return false if it timed out
  */
-void moveStraightDistance(double distance, bool fwd=true) {
-    // Robot moves at approximately 1.3 m/s
-    moveStraight(100, fwd, distance / 1.3 * 1000);
+bool moveStraightDistance(DriveIO &io, const DriveFeedforward &ff, double distance, bool fwd, double power,
+                          double start_speed, double end_speed) {
+    double sign = fwd ? 1. : -1.;
+    MotionProfile mp = makeProfile(distance, profileSpeed(ff, power), start_speed, end_speed);
+    // Give up at twice the time the move takes at top speed
+    int timeout = (int)(distance / topSpeed(ff) * 2000) + 500;
+    
+    double l0 = io.left();
+    double r0 = io.right();
+    for (int t = 0; t < timeout; t += MOVE_POLL_MS) {
+        bool moving = stepProfile(mp, MOVE_POLL_MS / 1000.);
+        double l = sign * (io.left() - l0);
+        double r = sign * (io.right() - r0);
+        if (end_speed > 0 && (l + r) / 2 >= distance - MOVE_TOLERANCE) return true;  // next move takes over
+        if (!moving && fabs(distance - (l + r) / 2) <= MOVE_TOLERANCE) {
+            io.hold();
+            return true;
+        }
+        
+        double p = profileVolts(ff, mp, moving, (l + r) / 2);
+        double correction = (l - r) * MOVE_STRAIGHT_KP;  // slow the side that is ahead
+        io.volts(sign * (p - correction), sign * (p + correction));
+        io.wait(MOVE_POLL_MS);
+    }
+    io.hold();
+    return false;
 }
 
 /*
- * Attempt to rotate an angle. Negative is left, 
- * positive is right. Angle is in degrees. Not 100% accurate.
+ * Rotate an angle. Positive is left (counter-clockwise), negative is right.
+ * Angle is in degrees.
+ * Follows a motion profile for the wheel arc with encoder feedback and finishes
+ * once the heading has settled within TURN_TOLERANCE, or at a timeout.
  *
- * @param angle Angle to rotate in degrees
+ * @param io      The drivetrain
+ * @param ff      Its feedforward constants turning in place, turn_ff on the robot
+ * @param angle   Angle to rotate in degrees
+ * @param power   Maximum power
+ * @param settle  Wait for the heading to settle? If false, finish as soon
+ *                as it is within TURN_TOLERANCE
+ * @return false if it timed out
  */
-void rotate(int angle) {
-    /* If turning left, right is forward, left backwards
-     * If turning right, right is backwards, left forwards */
-    vex::directionType dirL = angle < 0 ? vex::directionType::fwd : vex::directionType::rev;
-    vex::directionType dirR = angle > 0 ? vex::directionType::fwd : vex::directionType::rev;
+bool rotate(DriveIO &io, const DriveFeedforward &ff, int angle, double power, bool settle) {
+    /* For a positive angle the left side goes backwards and the right
+     * side forwards; negative angles the other way around */
+    double sign = angle < 0 ? -1. : 1.;
+    double arc_per_deg = TRACK_WIDTH / 2 * M_PI / 180.;  // wheel travel per degree turned
+    MotionProfile mp = makeProfile(abs(angle) * arc_per_deg, profileSpeed(ff, power));
+    // Give up at twice the time the turn takes at top speed
+    int timeout = (int)(abs(angle) * arc_per_deg / topSpeed(ff) * 2000) + 500;
+    int settled = 0;
     
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dirL, 100, percentUnits::pct);
-        rmotors[i].spin(dirR, 100, percentUnits::pct);
+    double l0 = io.left();
+    double r0 = io.right();
+    for (int t = 0; t < timeout; t += MOVE_POLL_MS) {
+        bool moving = stepProfile(mp, MOVE_POLL_MS / 1000.);
+        double turned = sign * turnedAngle(io, l0, r0);
+        if (!moving && fabs(abs(angle) - turned) < TURN_TOLERANCE) {
+            io.hold();
+            if (!settle) return true;
+            settled += MOVE_POLL_MS;
+        } else {
+            double p = sign * profileVolts(ff, mp, moving, turned * arc_per_deg);
+            io.volts(-p, p);
+            settled = 0;
+        }
+        io.wait(MOVE_POLL_MS);
+        if (settled >= MOVE_SETTLE_MS) return true;
     }
-    /* Calculate time to rotate (Rotates at around 0.36 deg/ms) */
-    int absAng = angle < 0 ? -angle : angle;
-    int time = absAng / 9 * 25;
-    
-    /* Slight adjustments for lower angles */
-    if (absAng < 80) time += 1500 / absAng;
-    else if (absAng < 190) time += 2300 / absAng;
-    else time -= 700 / absAng;
+    io.hold();
+    return false;
+}
+
+/*
+ * Turn an angle while driving forward along a circle of the given radius, so a
+ * straight move can run into the turn and out of it without stopping.
+ * Positive is left, negative is right, as in rotate(). The outer wheels run
+ * faster than the robot's center, so the center keeps below
+ * profileSpeed() / (1 + TRACK_WIDTH / (2 * radius)).
+ *
+ * @param io           The drivetrain
+ * @param ff           Its feedforward constants, drive_ff on the robot
+ * @param angle        Angle to turn in degrees
+ * @param radius       Radius of the robot's center path in meters
+ * @param power        Maximum power for the outer wheels
+ * @param start_speed  Speed the robot already has, m/s
+ * @param end_speed    Speed to hand over to the next move, m/s; 0 stops at the end
+ * @return false if it timed out
+ */
+bool arcTurn(DriveIO &io, const DriveFeedforward &ff, double angle, double radius, double power,
+             double start_speed, double end_speed) {
+    double sign = angle < 0 ? -1. : 1.;
+    double spread = TRACK_WIDTH / (2 * radius);  // outer/inner wheel speed is 1 +/- spread
+    double length = radius * fabs(angle) * M_PI / 180.;
+    MotionProfile mp = makeProfile(length, profileSpeed(ff, power) / (1 + spread), start_speed, end_speed);
+    int timeout = (int)(length / topSpeed(ff) * 2000) + 500;
     
-    task::sleep(time);
-    stopAllMotors();
+    double l0 = io.left();
+    double r0 = io.right();
+    for (int t = 0; t < timeout; t += MOVE_POLL_MS) {
+        bool moving = stepProfile(mp, MOVE_POLL_MS / 1000.);
+        double l = io.left() - l0;
+        double r = io.right() - r0;
+        double pos = (l + r) / 2;
+        if (end_speed > 0 && pos >= length - MOVE_TOLERANCE) return true;  // next move takes over
+        if (!moving && fabs(length - pos) <= MOVE_TOLERANCE) {
+            io.hold();
+            return true;
+        }
+        
+        // keep the heading on the circle: right minus left should be sign * pos * TRACK_WIDTH / radius
+        double correction = (sign * pos * TRACK_WIDTH / radius - (r - l)) * MOVE_STRAIGHT_KP;
+        io.volts(profileVolts(ff, mp, moving, pos, 1 - sign * spread) - correction,
+                 profileVolts(ff, mp, moving, pos, 1 + sign * spread) + correction);
+        io.wait(MOVE_POLL_MS);
+    }
+    io.hold();
+    return false;
 }
 
+/**
+ * Autonomous routines as data. A routine is a list of steps ending with STEP_END,
+ * written for the red alliance; steps with mirror set are turned the other way
+ * for blue. Routines are checked and resolved for both alliances in pre_auton(),
+ * so autonomous() only has to run the prepared steps.
+ */
+enum StepType { STEP_END, STEP_STRAIGHT, STEP_TURN, STEP_WAIT };
+
+// What happens when a step is done
+// END_STOP - stop, start the next step right away
+// END_SETTLE - stop and wait until the wheels are at rest before the next step
+// END_BLEND - hand the current speed over to the next step without stopping,
+//             if it goes the same way (forward straights and arcs, or backward
+//             straights); a turn in place skips settling instead
+enum StepEnd { END_STOP, END_SETTLE, END_BLEND };
+
+struct AutonStep {
+    StepType type;
+    double value;   // STRAIGHT: meters, negative is backwards; TURN: degrees, positive is left; WAIT: ms
+    double power;   // maximum power, %
+    bool mirror;    // negate value on the blue alliance
+    StepEnd end;
+    double radius;  // TURN: corner radius in meters, 0 turns in place. A corner takes
+                    // radius * tan(angle / 2) off the straights before and after it,
+                    // so the path still ends where the straights would have.
+};
+
 /**
  * Auton: go backwards to hit the flag, then forward
  * and go to platform 
  */
-void auton12(bool isRed) {
-    moveStraightDistance(1.65);
-    task::sleep(100);
-    moveStraightDistance(2.3, false);
-    task::sleep(100);
-    rotate(isRed ? -90 : 90);
-    moveStraightDistance(1.8);
+static AutonStep auton12_steps[] = {  // not const, step values can come from the tunables file
+    {STEP_STRAIGHT, 1.65, 100, false, END_STOP, 0},
+    {STEP_STRAIGHT, -2.3, 100, false, END_STOP, 0},
+    {STEP_TURN, -90, 100, true, END_BLEND, 0},
+    {STEP_STRAIGHT, 1.8, 100, false, END_STOP, 0},
+    {STEP_END, 0, 0, false, END_STOP, 0},
+};
+
+/**
+ * Auton: Rotate 90 degrees, go forward, rotate back and
+ * go forward onto the platform 
+ */
+static AutonStep auton34_steps[] = {
+    {STEP_TURN, -90, 100, true, END_BLEND, 0},
+    {STEP_STRAIGHT, 0.6, 100, false, END_BLEND, 0},
+    {STEP_TURN, 90, 100, true, END_BLEND, 0.3},
+    {STEP_STRAIGHT, 1.3, 100, false, END_STOP, 0},
+    {STEP_END, 0, 0, false, END_STOP, 0},
+};
+
+const int MAX_AUTON_STEPS = 16;
+const int NUM_AUTON_PLANS = 4;  // autonState 1-4; 5 is disabled
+const int NUM_AUTON_ROUTINES = 2;
+AutonStep *const auton_routines[NUM_AUTON_ROUTINES] = {auton12_steps, auton34_steps};
+
+struct PlanStep {
+    AutonStep step;
+    double start_speed;  // m/s handed over by the previous step
+    double end_speed;    // m/s handed over to the next step
+};
+
+struct AutonPlan {
+    bool valid;
+    PlanStep steps[MAX_AUTON_STEPS];  // mirrored for the alliance, ends with STEP_END
+};
+static AutonPlan auton_plans[NUM_AUTON_PLANS];
+
+const double SETTLE_SPEED = 2.;  // %, wheels count as at rest below this speed
+const int SETTLE_TIMEOUT_MS = 300;
+
+bool isCorner(const AutonStep &step) { return step.type == STEP_TURN && step.radius > 0; }
+bool movesForward(const AutonStep &step) { return (step.type == STEP_STRAIGHT && step.value > 0) || isCorner(step); }
+bool movesBackward(const AutonStep &step) { return step.type == STEP_STRAIGHT && step.value < 0; }
+
+// Highest center speed a step will reach, m/s
+double stepMaxSpeed(const AutonStep &step) {
+    double speed = profileSpeed(drive_ff, step.power);
+    if (isCorner(step)) speed /= 1 + TRACK_WIDTH / (2 * step.radius);
+    return speed;
 }
 
 /**
- * Auton: Rotate 35 degrees then go forward onto
- * the platform 
+ * Check a routine and resolve it for one alliance: mirror it, shorten the
+ * straights around corners and work out the speed each blended step hands over.
+ * @return false if the routine is too long, unterminated or has a bad step
  */
-void auton34(bool isRed) {
-    rotate(isRed ? -90 : 90);
-    moveStraightDistance(0.6);
-    rotate(isRed ? 90 : -90);
-    moveStraightDistance(1.3);
+bool prepareAutonPlan(const AutonStep *routine, bool isRed, AutonPlan &plan) {
+    plan.valid = false;
+    int n = 0;
+    for (;; n++) {
+        if (n == MAX_AUTON_STEPS) return false;  // no STEP_END within MAX_AUTON_STEPS
+        AutonStep step = routine[n];
+        plan.steps[n].step = step;
+        plan.steps[n].start_speed = plan.steps[n].end_speed = 0.;
+        if (step.type == STEP_END) break;
+        bool ok = std::isfinite(step.value) && step.power > 0 && step.power <= 100 &&
+                  std::isfinite(step.radius) && step.radius >= 0;
+        if (step.type == STEP_WAIT) ok = ok && step.value >= 0;
+        if (!ok || (step.type != STEP_STRAIGHT && step.type != STEP_TURN && step.type != STEP_WAIT)) {
+            return false;
+        }
+        if (step.mirror && !isRed) plan.steps[n].step.value = -step.value;
+    }
+    
+    // A corner needs forward straights on both sides to cut
+    for (int i = 0; i < n; i++) {
+        AutonStep &step = plan.steps[i].step;
+        if (!isCorner(step)) continue;
+        if (i == 0 || fabs(step.value) >= 180) return false;
+        AutonStep &before = plan.steps[i - 1].step;
+        AutonStep &after = plan.steps[i + 1].step;
+        if (!movesForward(before) || isCorner(before) || !movesForward(after) || isCorner(after)) return false;
+        double cut = step.radius * tan(fabs(step.value) * M_PI / 360.);
+        before.value -= cut;
+        after.value -= cut;
+        if (before.value < 0 || after.value < 0) return false;
+    }
+    
+    // Blend into the next step only while the robot keeps going the same way
+    for (int i = 0; i + 1 < n; i++) {
+        const AutonStep &step = plan.steps[i].step;
+        const AutonStep &next = plan.steps[i + 1].step;
+        if (step.end != END_BLEND) continue;
+        if ((movesForward(step) && movesForward(next)) || (movesBackward(step) && movesBackward(next))) {
+            double speed = fmin(stepMaxSpeed(step), stepMaxSpeed(next));
+            plan.steps[i].end_speed = plan.steps[i + 1].start_speed = speed;
+        }
+    }
+    plan.valid = true;
+    return true;
+}
+
+// Wait until both sides of the drive are at rest, or SETTLE_TIMEOUT_MS
+void settleDrive(DriveIO &io) {
+    for (int t = 0; t < SETTLE_TIMEOUT_MS; t += MOVE_POLL_MS) {
+        if (io.speedPct() < SETTLE_SPEED) break;
+        io.wait(MOVE_POLL_MS);
+    }
+}
+
+/**
+ * Run one step of a plan. Turns in place go to the heading the plan has
+ * reached so far, measured from io.heading(), so heading error left over from
+ * earlier steps (a turn that stopped within TURN_TOLERANCE, a corner that came
+ * up short) is taken out instead of adding up.
+ * @param io       The drivetrain
+ * @param dff      Its feedforward constants, drive_ff and turn_ff on the robot
+ * @param tff
+ * @param ps       The step
+ * @param heading  Where the plan wants the robot to face so far, deg; the step's turn is added
+ * @return false if a move timed out
+ */
+bool runPlanStep(DriveIO &io, const DriveFeedforward &dff, const DriveFeedforward &tff, const PlanStep &ps,
+                 double &heading) {
+    const AutonStep &step = ps.step;
+    bool ok = true;
+    switch (step.type) {
+        case STEP_STRAIGHT:
+            ok = moveStraightDistance(io, dff, fabs(step.value), step.value >= 0, step.power, ps.start_speed,
+                                      ps.end_speed);
+            break;
+        case STEP_TURN:
+            heading += step.value;
+            if (isCorner(step)) {
+                // the straights around it were cut for this angle, so a corner keeps it
+                ok = arcTurn(io, dff, step.value, step.radius, step.power, ps.start_speed, ps.end_speed);
+            } else {
+                double turn = heading - io.heading() * 180. / M_PI;
+                ok = rotate(io, tff, (int)lround(turn), step.power, step.end != END_BLEND);
+            }
+            break;
+        case STEP_WAIT:
+            io.wait((int)step.value);
+            break;
+        case STEP_END:
+            break;
+    }
+    if (step.end == END_SETTLE) settleDrive(io);
+    return ok;
+}
+
+// How long each step of the last plan run took, ms, for tuning
+int auton_step_ms[MAX_AUTON_STEPS];
+int auton_steps_run = 0;
+
+// Show the step times of the last run on the brain screen
+void displayAutonStepTimes() {
+    Brain.Screen.setCursor(5,0);
+    Brain.Screen.clearLine();
+    int total = 0;
+    for (int i = 0; i < auton_steps_run; i++) total += auton_step_ms[i];
+    Brain.Screen.print("Last run %d ms:", total);
+    for (int i = 0; i < auton_steps_run; i++) Brain.Screen.print(" %d", auton_step_ms[i]);
+    Brain.Screen.render();
+}
+
+// Run a prepared plan on the robot, heading measured by odometry from where it starts
+void runAutonPlan(const AutonPlan &plan) {
+    auton_steps_run = 0;
+    if (!plan.valid) return;
+    double heading = robot_drive.heading() * 180. / M_PI;
+    for (const PlanStep *ps = plan.steps; ps->step.type != STEP_END; ps++) {
+        double start = Brain.timer(timeUnits::msec);
+        runPlanStep(robot_drive, drive_ff, turn_ff, *ps, heading);
+        auton_step_ms[auton_steps_run++] = (int)(Brain.timer(timeUnits::msec) - start);
+    }
+    displayAutonStepTimes();
+}
+
+// Prepare all autonomous plans; reports routines that fail the check on the brain screen
+void prepareAutonPlans() {
+    for (int i = 0; i < NUM_AUTON_PLANS; i++) {
+        bool isRed = i % 2 == 0;  // states 1 and 3 are red, 2 and 4 the same routines for blue
+        if (!prepareAutonPlan(auton_routines[i / 2], isRed, auton_plans[i])) {
+            Brain.Screen.setCursor(4,0);
+            Brain.Screen.clearLine();
+            Brain.Screen.print("A%d routine invalid, will do nothing", i + 1);
+        }
+    }
+}
+
+/**
+ * Drivetrain characterization (auton state 7). Measures drive_ff and turn_ff
+ * from the encoders in about 35 s; the robot needs CHAR_MAX_TRAVEL of clear
+ * floor in front and behind. Each measurement is made forwards and then
+ * backwards, which also brings the robot back to about where it started:
+ *  - quasi-static: the voltage ramps up slowly, so acceleration is negligible
+ *    and V = ks + kv * v, fitted by least squares
+ *  - step: a sudden CHAR_STEP_VOLTS from rest; what ks and kv do not account
+ *    for is ka * a, fitted through the origin
+ * then the same two turning in place. Results are shown on the brain screen,
+ * used by the moves from then on and saved to the tunables file.
+ */
+const int CHARACTERIZE_AUTON_STATE = 7;
+const double CHAR_RAMP_VOLTS_PER_S = 1.;
+const double CHAR_MAX_VOLTS = 7.;
+const double CHAR_STEP_VOLTS = 6.;
+const int CHAR_STEP_MS = 1000;
+const double CHAR_MAX_TRAVEL = 1.5;  // m each way, driving straight
+const double CHAR_MIN_SPEED = 0.02;  // m/s, slower samples are still stuck in static friction
+const int CHAR_PERIOD_MS = 10;
+const int CHAR_REST_MS = 500;        // between runs
+
+// Running sums for a least squares fit of y = a + b * x
+struct LineFit {
+    double n, sx, sy, sxx, sxy;
+};
+
+void addPoint(LineFit &f, double x, double y) {
+    f.n += 1;
+    f.sx += x;
+    f.sy += y;
+    f.sxx += x * x;
+    f.sxy += x * y;
+}
+
+/**
+ * Drive one characterization run and add its samples to the fits.
+ * @param turn   Turn in place (left side backwards) instead of driving straight
+ * @param dir    1 forwards or counter-clockwise, -1 the other way
+ * @param ramp   Quasi-static ramp, otherwise a step
+ * @param known  ks and kv, for the step run
+ */
+void characterizeRun(bool turn, double dir, bool ramp, LineFit &quasi_static, LineFit &accel,
+                     const DriveFeedforward &known) {
+    double l0 = leftDistance();
+    double r0 = rightDistance();
+    double prev_speed = 0.;
+    int max_ms = ramp ? (int)(CHAR_MAX_VOLTS / CHAR_RAMP_VOLTS_PER_S * 1000) : CHAR_STEP_MS;
+    for (int t = 0; t < max_ms; t += CHAR_PERIOD_MS) {
+        double travel = turn ? ((rightDistance() - r0) - (leftDistance() - l0)) / 2 * dir
+                             : ((leftDistance() - l0) + (rightDistance() - r0)) / 2 * dir;
+        if (!turn && travel > CHAR_MAX_TRAVEL) break;
+        double volts = ramp ? CHAR_RAMP_VOLTS_PER_S * t / 1000. : CHAR_STEP_VOLTS;
+        driveVolts(dir * (turn ? -volts : volts), dir * volts);
+        task::sleep(CHAR_PERIOD_MS);
+        
+        double speed = turn ? (rightSpeed() - leftSpeed()) / 2 * dir : (leftSpeed() + rightSpeed()) / 2 * dir;
+        double accel_now = (speed - prev_speed) / (CHAR_PERIOD_MS / 1000.);
+        prev_speed = speed;
+        if (speed < CHAR_MIN_SPEED) continue;
+        if (ramp) {
+            addPoint(quasi_static, speed, volts);
+        } else {
+            addPoint(accel, accel_now, volts - known.ks - known.kv * speed);
+        }
+    }
+    set_stopping_mode_for_motors(brake);
+    stopAllMotors();
+    task::sleep(CHAR_REST_MS);
+}
+
+/**
+ * Characterize straight driving or turning.
+ * @return false if the measurements make no sense (robot blocked, motors unplugged...)
+ */
+bool characterizeMotion(bool turn, DriveFeedforward &ff) {
+    LineFit quasi_static = {0, 0, 0, 0, 0};
+    LineFit accel = {0, 0, 0, 0, 0};
+    characterizeRun(turn, 1., true, quasi_static, accel, ff);
+    characterizeRun(turn, -1., true, quasi_static, accel, ff);
+    double det = quasi_static.n * quasi_static.sxx - quasi_static.sx * quasi_static.sx;
+    if (quasi_static.n < 10 || det <= 0) return false;
+    DriveFeedforward fit;
+    fit.kv = (quasi_static.n * quasi_static.sxy - quasi_static.sx * quasi_static.sy) / det;
+    fit.ks = fmax(0., (quasi_static.sy - fit.kv * quasi_static.sx) / quasi_static.n);
+    fit.ka = 0.;
+    if (fit.kv <= 0 || fit.ks >= CHAR_MAX_VOLTS) return false;
+    
+    characterizeRun(turn, 1., false, quasi_static, accel, fit);
+    characterizeRun(turn, -1., false, quasi_static, accel, fit);
+    if (accel.n < 10 || accel.sxx <= 0) return false;
+    fit.ka = accel.sxy / accel.sxx;
+    if (fit.ka <= 0) return false;
+    ff = fit;
+    return true;
+}
+
+void characterizeDrive() {
+    bool drive_ok = characterizeMotion(false, drive_ff);
+    bool turn_ok = characterizeMotion(true, turn_ff);
+    prepareAutonPlans();  // hand-over speeds depend on the top speed
+    
+    Brain.Screen.setCursor(6,0);
+    Brain.Screen.clearLine();
+    if (drive_ok) Brain.Screen.print("Drive ks %.2f V kv %.2f V/(m/s) ka %.2f V/(m/s^2)", drive_ff.ks, drive_ff.kv, drive_ff.ka);
+    else Brain.Screen.print("Drive characterization failed, kept old values");
+    Brain.Screen.setCursor(7,0);
+    Brain.Screen.clearLine();
+    if (turn_ok) Brain.Screen.print("Turn  ks %.2f V kv %.2f V/(m/s) ka %.2f V/(m/s^2)", turn_ff.ks, turn_ff.kv, turn_ff.ka);
+    else Brain.Screen.print("Turn characterization failed, kept old values");
+    Brain.Screen.render();
+}
+
+/**
+ * Driver recording and playback.
+ * Press L1 in driver control to start recording the controller, and again to
+ * stop; a recording also stops when it reaches MAX_RECORD_MS (a skills run)
+ * or fills its buffer. Auton state 6 plays it back through arcadedrive() and
+ * the button handlers, so the robot drives what the driver did. Samples are
+ * replayed on the recording's own clock, and the wheel distances recorded with
+ * each sample pull the robot back onto the recorded path if it falls behind or
+ * gets ahead.
+ * When a recording stops, the telemetry task saves it to ROUTINE_FILE on the
+ * SD card, and pre_auton() loads it back, so a routine recorded in practice
+ * is there for autonomous in the next match. Without a card the recording is
+ * kept in memory only.
+ */
+const int DRIVE_PERIOD_MS = 5;  // driver control loop period
+const int MAX_RECORD_MS = 60000;
+const double PLAYBACK_KP = 1000.;  // % power per meter a side is off the recorded path
+const int REPLAY_AUTON_STATE = 6;
+
+// Buttons that are recorded and replayed, with what they do
+struct ButtonBinding {
+    vex::controller::button *button;
+    void (*on_press)(void);
+};
+const ButtonBinding button_bindings[] = {
+    {&Controller1.ButtonX, spinner_toggle},
+    {&Controller1.ButtonUp, spinner_rpm_up},
+    {&Controller1.ButtonDown, spinner_rpm_down},
+    {&Controller1.ButtonB, reverse_toggle},
+    {&Controller1.ButtonRight, smooth_power_up},
+    {&Controller1.ButtonLeft, smooth_power_down},
+    {&Controller1.ButtonY, toggle_print_info},
+    {&Controller1.ButtonA, stopping_mode_toggle},
+};
+const int NUM_BUTTON_BINDINGS = sizeof(button_bindings) / sizeof(button_bindings[0]);
+
+// One control tick of driver input
+struct DriverSample {
+    uint32_t t_ms;      // since the start of the recording
+    int8_t axis1;       // joystick values
+    int8_t axis2;
+    uint16_t buttons;   // bit i set while button_bindings[i] is pressed
+    float left;         // wheel distances since the start of the recording, m
+    float right;
+};
+
+// Driver settings a recording starts from; playback starts from the same ones
+struct DriveSettings {
+    int curve_preset;
+    bool reversed;
+    int stopping_mode_num;
+    int spinner_state;
+    double spinner_rpm;
+};
+
+/**
+ * Routine format. A recording is a byte string, little-endian, that can be
+ * stored or sent as is:
+ *
+ * Header, ROUTINE_HEADER_BYTES:
+ *   "SHSR", version, drive mode, sample period ms, curve preset, reversed,
+ *   stopping mode, spinner state, spinner rpm (u16), sample count (u32)
+ * Then for each sample, as zigzag varints of the change from the last sample:
+ *   time minus the sample period (ms), axis1, axis2, left and right wheel
+ *   distance (mm)
+ * followed, when the previous button run has ended (and for the first
+ * sample), by the button mask (u16) and how many samples it lasts (u16).
+ *
+ * A held stick or a steady speed costs about one byte per value, so a tick
+ * takes 5-7 bytes against 16 for a DriverSample.
+ */
+const uint8_t ROUTINE_MAGIC[4] = {'S', 'H', 'S', 'R'};
+const uint8_t ROUTINE_VERSION = 1;
+const int ROUTINE_HEADER_BYTES = 18;
+const int ROUTINE_MAX_SAMPLE_BYTES = 5 * 5 + 4;  // five 32-bit varints and a button run
+const int ROUTINE_BUF_BYTES = MAX_RECORD_MS / DRIVE_PERIOD_MS * 7 + ROUTINE_HEADER_BYTES;
+
+// Which joystick axes a recording drives with
+enum DriveMode { DRIVE_ARCADE, DRIVE_TANK };
+
+struct RoutineHeader {
+    DriveMode drive_mode;
+    int period_ms;
+    DriveSettings settings;
+    uint32_t sample_count;
+};
+
+// Fills a buffer with a routine one sample at a time; the buffer holds a
+// complete routine after every sample
+struct RoutineWriter {
+    uint8_t *buf;
+    int cap;
+    int len;
+    int period_ms;
+    uint32_t count;
+    DriverSample last;  // as it will be decoded
+    int32_t left_mm;
+    int32_t right_mm;
+    int run_pos;        // where the current button run length is kept
+    uint16_t run;
+};
+
+// Decodes a routine one sample at a time, without copying it
+struct RoutineReader {
+    const uint8_t *buf;
+    int len;
+    int pos;
+    int period_ms;
+    uint32_t remaining;
+    DriverSample last;
+    int32_t left_mm;
+    int32_t right_mm;
+    uint16_t run;
+};
+
+void putU16(uint8_t *p, uint32_t v) { p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; }
+void putU32(uint8_t *p, uint32_t v) { putU16(p, v); putU16(p + 2, v >> 16); }
+uint32_t getU16(const uint8_t *p) { return p[0] | (uint32_t)p[1] << 8; }
+uint32_t getU32(const uint8_t *p) { return getU16(p) | getU16(p + 2) << 16; }
+
+int putVarint(uint8_t *p, int32_t value) {
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);  // zigzag: small magnitudes -> small numbers
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// @return false if the varint runs past len or is longer than 32 bits
+bool getVarint(const uint8_t *buf, int len, int &pos, int32_t &value) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= len) return false;
+        uint8_t b = buf[pos++];
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Start a routine in buf.
+ * @return false if buf cannot hold the header
+ */
+bool routineWriterInit(RoutineWriter &w, uint8_t *buf, int cap, const RoutineHeader &hdr) {
+    if (cap < ROUTINE_HEADER_BYTES) return false;
+    memcpy(buf, ROUTINE_MAGIC, 4);
+    buf[4] = ROUTINE_VERSION;
+    buf[5] = (uint8_t)hdr.drive_mode;
+    buf[6] = (uint8_t)hdr.period_ms;
+    buf[7] = (uint8_t)hdr.settings.curve_preset;
+    buf[8] = hdr.settings.reversed ? 1 : 0;
+    buf[9] = (uint8_t)hdr.settings.stopping_mode_num;
+    buf[10] = (uint8_t)hdr.settings.spinner_state;
+    putU16(buf + 11, (uint32_t)lround(hdr.settings.spinner_rpm));
+    putU32(buf + 13, 0);
+    buf[17] = 0;  // reserved
+    
+    w.buf = buf;
+    w.cap = cap;
+    w.len = ROUTINE_HEADER_BYTES;
+    w.period_ms = hdr.period_ms;
+    w.count = 0;
+    memset(&w.last, 0, sizeof(w.last));
+    w.left_mm = w.right_mm = 0;
+    w.run_pos = -1;
+    w.run = 0;
+    return true;
+}
+
+/**
+ * Append a sample. Times must not go backwards.
+ * @return false if the buffer is full; the routine so far stays valid
+ */
+bool routineWrite(RoutineWriter &w, const DriverSample &s) {
+    if (w.cap - w.len < ROUTINE_MAX_SAMPLE_BYTES) return false;
+    int32_t left_mm = (int32_t)lround(s.left * 1000.);
+    int32_t right_mm = (int32_t)lround(s.right * 1000.);
+    uint8_t *p = w.buf + w.len;
+    int n = 0;
+    n += putVarint(p + n, (int32_t)(s.t_ms - w.last.t_ms) - w.period_ms);
+    n += putVarint(p + n, s.axis1 - w.last.axis1);
+    n += putVarint(p + n, s.axis2 - w.last.axis2);
+    n += putVarint(p + n, left_mm - w.left_mm);
+    n += putVarint(p + n, right_mm - w.right_mm);
+    if (w.run_pos < 0 || s.buttons != w.last.buttons || w.run == 0xffff) {
+        putU16(p + n, s.buttons);
+        w.run_pos = w.len + n + 2;
+        w.run = 0;
+        n += 4;
+    }
+    w.run++;
+    putU16(w.buf + w.run_pos, w.run);
+    w.len += n;
+    w.count++;
+    putU32(w.buf + 13, w.count);
+    
+    w.last = s;
+    w.left_mm = left_mm;
+    w.right_mm = right_mm;
+    return true;
+}
+
+/**
+ * Check a routine's header and get ready to read its samples.
+ * @return false if buf does not hold a routine this program can read
+ */
+bool routineReaderInit(RoutineReader &rd, const uint8_t *buf, int len, RoutineHeader &hdr) {
+    if (len < ROUTINE_HEADER_BYTES || memcmp(buf, ROUTINE_MAGIC, 4) != 0 || buf[4] != ROUTINE_VERSION) {
+        return false;
+    }
+    if (buf[5] > DRIVE_TANK || buf[6] == 0 || buf[7] >= NUM_CURVE_PRESETS || buf[9] > 2 || buf[10] > 3) {
+        return false;
+    }
+    hdr.drive_mode = (DriveMode)buf[5];
+    hdr.period_ms = buf[6];
+    hdr.settings.curve_preset = buf[7];
+    hdr.settings.reversed = buf[8] != 0;
+    hdr.settings.stopping_mode_num = buf[9];
+    hdr.settings.spinner_state = buf[10];
+    hdr.settings.spinner_rpm = getU16(buf + 11);
+    hdr.sample_count = getU32(buf + 13);
+    
+    rd.buf = buf;
+    rd.len = len;
+    rd.pos = ROUTINE_HEADER_BYTES;
+    rd.period_ms = hdr.period_ms;
+    rd.remaining = hdr.sample_count;
+    memset(&rd.last, 0, sizeof(rd.last));
+    rd.left_mm = rd.right_mm = 0;
+    rd.run = 0;
+    return true;
+}
+
+/**
+ * Decode the next sample.
+ * @return false at the end of the routine, or if the rest of it is malformed
+ */
+bool routineNext(RoutineReader &rd, DriverSample &s) {
+    if (rd.remaining == 0) return false;
+    int32_t dt, d1, d2, dl, dr;
+    if (!getVarint(rd.buf, rd.len, rd.pos, dt) || !getVarint(rd.buf, rd.len, rd.pos, d1) ||
+        !getVarint(rd.buf, rd.len, rd.pos, d2) || !getVarint(rd.buf, rd.len, rd.pos, dl) ||
+        !getVarint(rd.buf, rd.len, rd.pos, dr)) {
+        rd.remaining = 0;
+        return false;
+    }
+    if (rd.run == 0) {
+        if (rd.len - rd.pos < 4 || getU16(rd.buf + rd.pos + 2) == 0) {
+            rd.remaining = 0;
+            return false;
+        }
+        rd.last.buttons = getU16(rd.buf + rd.pos);
+        rd.run = getU16(rd.buf + rd.pos + 2);
+        rd.pos += 4;
+    }
+    rd.run--;
+    rd.remaining--;
+    
+    rd.last.t_ms += dt + rd.period_ms;
+    rd.last.axis1 = (int8_t)(rd.last.axis1 + d1);
+    rd.last.axis2 = (int8_t)(rd.last.axis2 + d2);
+    rd.left_mm += dl;
+    rd.right_mm += dr;
+    rd.last.left = rd.left_mm / 1000.f;
+    rd.last.right = rd.right_mm / 1000.f;
+    s = rd.last;
+    return true;
+}
+
+const char ROUTINE_FILE[] = "shs_route.bin";
+
+// A stopped recording on its way to the card. The telemetry task only reads
+// routine_buf while SAVING, and a new recording does not start then.
+enum RoutineSave { ROUTINE_SAVED, ROUTINE_SAVE_DUE, ROUTINE_SAVING };
+
+static uint8_t routine_buf[ROUTINE_BUF_BYTES];  // preallocated, no allocation while driving
+static RoutineWriter routine_writer;  // the routine auton state 6 plays; len 0 - nothing recorded
+static bool recording_on = false;
+static double record_start_ms, record_l0, record_r0;
+static std::atomic<int> routine_save(ROUTINE_SAVED);
+
+DriveSettings currentDriveSettings() {
+    DriveSettings ds = {curve_preset, reversed, stopping_mode_num, spinner_state, spinner_rpm};
+    return ds;
+}
+
+void applyDriveSettings(const DriveSettings &ds) {
+    set_curve_preset(ds.curve_preset);
+    reversed = ds.reversed;
+    stopping_mode_num = ds.stopping_mode_num;
+    set_stopping_mode_for_motors(stopping_mode[stopping_mode_num]);
+    spinner_state = ds.spinner_state;
+    spinner_rpm = fmax(1., fmin(SPINNER_MAX_RPM, ds.spinner_rpm));  // a recording's header is only a u16
+    tunables_changed = true;
+    set_spin();
+}
+
+uint16_t pressedButtons() {
+    uint16_t bits = 0;
+    for (int i = 0; i < NUM_BUTTON_BINDINGS; i++) {
+        if (button_bindings[i].button->pressing()) bits |= 1 << i;
+    }
+    return bits;
+}
+
+void record_toggle() {
+    if (!recording_on) {
+        // A new recording replaces one still waiting to be saved, but waits for one being written
+        int state = ROUTINE_SAVE_DUE;
+        if (!routine_save.compare_exchange_strong(state, ROUTINE_SAVED, std::memory_order_acquire) &&
+            state == ROUTINE_SAVING) {
+            Controller1.rumble(".");
+            return;
+        }
+        recording_on = true;
+        RoutineHeader hdr = {DRIVE_ARCADE, DRIVE_PERIOD_MS, currentDriveSettings(), 0};
+        routineWriterInit(routine_writer, routine_buf, ROUTINE_BUF_BYTES, hdr);
+        record_start_ms = Brain.timer(timeUnits::msec);
+        record_l0 = leftDistance();
+        record_r0 = rightDistance();
+        Controller1.rumble("-");
+    } else {
+        recording_on = false;
+        routine_save.store(ROUTINE_SAVE_DUE, std::memory_order_release);
+        Controller1.rumble("--");
+    }
+}
+
+// Add the driver's input for this control tick to the recording, if one is running
+void recordSample(int32_t axis1, int32_t axis2) {
+    if (!recording_on) return;
+    DriverSample ds;
+    double t = Brain.timer(timeUnits::msec) - record_start_ms;
+    ds.t_ms = (uint32_t)t;
+    ds.axis1 = (int8_t)axis1;
+    ds.axis2 = (int8_t)axis2;
+    ds.buttons = pressedButtons();
+    ds.left = (float)(leftDistance() - record_l0);
+    ds.right = (float)(rightDistance() - record_r0);
+    if (t > MAX_RECORD_MS || !routineWrite(routine_writer, ds)) {
+        record_toggle();  // full
+    }
+}
+
+/**
+ * Play back a routine. Each sample is applied at its recorded time after the
+ * start; if the task wakes late, every sample that is due is caught up on so
+ * no button press is lost, and the joysticks jump to the latest one.
+ * Timing is kept against the start rather than by adding up sleeps, so it
+ * does not drift over the run.
+ */
+void playRoutine(const uint8_t *buf, int len) {
+    RoutineHeader hdr;
+    RoutineReader rd;
+    if (!routineReaderInit(rd, buf, len, hdr) || hdr.drive_mode != DRIVE_ARCADE) return;
+    DriveSettings driver_settings = currentDriveSettings();
+    applyDriveSettings(hdr.settings);
+    double start = Brain.timer(timeUnits::msec);
+    double l0 = leftDistance();
+    double r0 = rightDistance();
+    uint16_t buttons = 0;
+    
+    DriverSample next;
+    bool more = routineNext(rd, next);
+    while (more) {
+        double now = Brain.timer(timeUnits::msec) - start;
+        DriverSample ds;
+        bool due = false;
+        while (more && next.t_ms <= now) {
+            ds = next;
+            due = true;
+            uint16_t pressed = ds.buttons & ~buttons;
+            for (int b = 0; b < NUM_BUTTON_BINDINGS; b++) {
+                if (pressed & (1 << b)) button_bindings[b].on_press();
+            }
+            buttons = ds.buttons;
+            more = routineNext(rd, next);
+        }
+        if (due) {
+            double ltrim = (ds.left - (leftDistance() - l0)) * PLAYBACK_KP;
+            double rtrim = (ds.right - (rightDistance() - r0)) * PLAYBACK_KP;
+            arcadedrive(ds.axis1, ds.axis2, ltrim, rtrim);
+        }
+        if (more) {
+            double wait = next.t_ms - (Brain.timer(timeUnits::msec) - start);
+            task::sleep(wait > 1 ? (uint32_t)wait : 1);
+        }
+    }
+    spin_motors(0., 0.);
+    cur_lp = cur_rp = 0.;
+    applyDriveSettings(driver_settings);
+}
+
+void playRecording() {
+    if (!recording_on) playRoutine(routine_buf, routine_writer.len);
+}
+
+/**
+ * Write the last recording to ROUTINE_FILE if it stopped since the last save.
+ * Only the telemetry task calls this.
+ * @return false if a write was needed and failed
+ */
+bool saveRecordingIfDue() {
+    int state = ROUTINE_SAVE_DUE;
+    if (!routine_save.compare_exchange_strong(state, ROUTINE_SAVING, std::memory_order_acquire)) return true;
+    bool ok = Brain.SDcard.savefile(ROUTINE_FILE, routine_buf, routine_writer.len) == routine_writer.len;
+    routine_save.store(ROUTINE_SAVED, std::memory_order_release);
+    return ok;
+}
+
+/**
+ * Load ROUTINE_FILE for auton state 6, if it holds a routine this program can
+ * play. Call from pre_auton(), before driver control can record.
+ * @return whether a routine was loaded
+ */
+bool loadRecording() {
+    if (!Brain.SDcard.isInserted()) return false;
+    int len = Brain.SDcard.loadfile(ROUTINE_FILE, routine_buf, ROUTINE_BUF_BYTES);
+    RoutineHeader hdr;
+    RoutineReader rd;
+    if (len <= 0 || !routineReaderInit(rd, routine_buf, len, hdr) || hdr.drive_mode != DRIVE_ARCADE) return false;
+    routine_writer.buf = routine_buf;
+    routine_writer.cap = ROUTINE_BUF_BYTES;
+    routine_writer.len = len;
+    routine_writer.count = hdr.sample_count;
+    return true;
+}
+
+/**
+ * Tunables file. The values worth adjusting without a rebuild are kept in
+ * TUNABLES_FILE on the brain's SD card, little-endian:
+ *
+ *   "SHST", version (u16), payload length (u16)
+ *   payload: curve preset (u8), deadzone, spinner rpm, spinner rpm multiplier,
+ *            drive ks kv ka, turn ks kv ka (f32 each), then for each of the
+ *            NUM_AUTON_ROUTINES routines its step count (u8) and
+ *            MAX_AUTON_STEPS step values (f32)
+ *   CRC-32 of everything before it (u32)
+ *
+ * pre_auton() reads it in one loadfile() into a Tunables. A missing card or
+ * file, another version, a bad CRC or a value out of range all leave the
+ * compiled defaults in place. Step values are only taken for a routine whose
+ * step count still matches the program's, so editing a routine drops its stale
+ * values but keeps the rest. The file is written back after auton 7 and when
+ * the driver changes the curve or spinner speed on the controller. Writing
+ * takes a few ms, so the task that changed the values only publishes them
+ * (publishTunables()) and the low-priority telemetry task saves them.
+ * Changing the payload layout needs a new TUNABLES_VERSION.
+ */
+const char TUNABLES_FILE[] = "shs_tunables.bin";
+const uint8_t TUNABLES_MAGIC[4] = {'S', 'H', 'S', 'T'};
+const uint16_t TUNABLES_VERSION = 1;
+const int TUNABLES_HEADER_BYTES = 8;
+const int TUNABLES_PAYLOAD_BYTES = 1 + 3 * 4 + 6 * 4 + NUM_AUTON_ROUTINES * (1 + MAX_AUTON_STEPS * 4);
+const int TUNABLES_FILE_BYTES = TUNABLES_HEADER_BYTES + TUNABLES_PAYLOAD_BYTES + 4;
+const int TUNABLES_CHECK_MS = 1000;  // how often the telemetry task looks for changes to save
+
+struct Tunables {
+    int curve_preset;
+    double deadzone;
+    double spinner_rpm;
+    double spinner_rpm_mult;
+    DriveFeedforward drive_ff;
+    DriveFeedforward turn_ff;
+    int step_count[NUM_AUTON_ROUTINES];
+    double step_value[NUM_AUTON_ROUTINES][MAX_AUTON_STEPS];
+};
+
+static uint8_t tunables_saved[TUNABLES_FILE_BYTES];  // what the file holds, as far as we know
+static bool tunables_card = false;                   // the SD card was there at startup
+static Seqlock<Tunables> tunables_state;             // the latest values, for the telemetry task
+
+// Standard CRC-32 (as zlib), bit by bit; the file is small
+uint32_t crc32(const uint8_t *p, int len) {
+    uint32_t crc = 0xffffffffu;
+    for (int i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+void putF32(uint8_t *p, double v) {
+    float f = (float)v;
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    putU32(p, bits);
+}
+
+double getF32(const uint8_t *p) {
+    uint32_t bits = getU32(p);
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+int routineStepCount(const AutonStep *routine) {
+    int n = 0;
+    while (n < MAX_AUTON_STEPS && routine[n].type != STEP_END) n++;
+    return n;
+}
+
+Tunables currentTunables() {
+    Tunables t;
+    t.curve_preset = curve_preset;
+    t.deadzone = deadzone;
+    t.spinner_rpm = spinner_rpm;
+    t.spinner_rpm_mult = spinner_rpm_mult;
+    t.drive_ff = drive_ff;
+    t.turn_ff = turn_ff;
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        t.step_count[r] = routineStepCount(auton_routines[r]);
+        for (int i = 0; i < MAX_AUTON_STEPS; i++) {
+            t.step_value[r][i] = i < t.step_count[r] ? auton_routines[r][i].value : 0.;
+        }
+    }
+    return t;
+}
+
+// Use a set of tunables; call prepareAutonPlans() afterwards for the step values to count
+void applyTunables(const Tunables &t) {
+    set_curve_preset(t.curve_preset);
+    deadzone = t.deadzone;
+    spinner_rpm = t.spinner_rpm;
+    spinner_rpm_mult = t.spinner_rpm_mult;
+    drive_ff = t.drive_ff;
+    turn_ff = t.turn_ff;
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        if (t.step_count[r] != routineStepCount(auton_routines[r])) continue;
+        for (int i = 0; i < t.step_count[r]; i++) auton_routines[r][i].value = t.step_value[r][i];
+    }
+}
+
+// Encode into buf, which must hold TUNABLES_FILE_BYTES
+void encodeTunables(const Tunables &t, uint8_t *buf) {
+    memcpy(buf, TUNABLES_MAGIC, 4);
+    putU16(buf + 4, TUNABLES_VERSION);
+    putU16(buf + 6, TUNABLES_PAYLOAD_BYTES);
+    uint8_t *p = buf + TUNABLES_HEADER_BYTES;
+    *p++ = (uint8_t)t.curve_preset;
+    const double values[] = {t.deadzone, t.spinner_rpm, t.spinner_rpm_mult,
+                             t.drive_ff.ks, t.drive_ff.kv, t.drive_ff.ka, t.turn_ff.ks, t.turn_ff.kv, t.turn_ff.ka};
+    for (double v : values) { putF32(p, v); p += 4; }
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        *p++ = (uint8_t)t.step_count[r];
+        for (int i = 0; i < MAX_AUTON_STEPS; i++) { putF32(p, t.step_value[r][i]); p += 4; }
+    }
+    putU32(p, crc32(buf, TUNABLES_FILE_BYTES - 4));
+}
+
+bool feedforwardValid(const DriveFeedforward &ff) {
+    return ff.ks >= 0 && ff.ks < MAX_VOLTS && ff.kv > 0 && ff.kv < 1000 && ff.ka > 0 && ff.ka < 1000;
+}
+
+// Whether every value is in the range decodeTunables() accepts
+bool tunablesValid(const Tunables &t) {
+    // NaN fails every comparison, so it is caught here too
+    return t.curve_preset >= 0 && t.curve_preset < NUM_CURVE_PRESETS &&
+           t.deadzone >= 0 && t.deadzone <= 0.5 &&
+           t.spinner_rpm > 0 && t.spinner_rpm <= SPINNER_MAX_RPM &&
+           t.spinner_rpm_mult > 1 && t.spinner_rpm_mult <= 1.5 &&
+           feedforwardValid(t.drive_ff) && feedforwardValid(t.turn_ff);
+}
+
+/**
+ * Decode and check a tunables file.
+ * @return false if it is not a complete, intact file of this version with
+ *         every value in range; t is then unspecified
+ */
+bool decodeTunables(const uint8_t *buf, int len, Tunables &t) {
+    if (len != TUNABLES_FILE_BYTES || memcmp(buf, TUNABLES_MAGIC, 4) != 0 ||
+        getU16(buf + 4) != TUNABLES_VERSION || getU16(buf + 6) != TUNABLES_PAYLOAD_BYTES ||
+        getU32(buf + len - 4) != crc32(buf, len - 4)) {
+        return false;
+    }
+    const uint8_t *p = buf + TUNABLES_HEADER_BYTES;
+    t.curve_preset = *p++;
+    double *values[] = {&t.deadzone, &t.spinner_rpm, &t.spinner_rpm_mult,
+                        &t.drive_ff.ks, &t.drive_ff.kv, &t.drive_ff.ka, &t.turn_ff.ks, &t.turn_ff.kv, &t.turn_ff.ka};
+    for (double *v : values) { *v = getF32(p); p += 4; }
+    bool ok = true;
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        t.step_count[r] = *p++;
+        ok = ok && t.step_count[r] <= MAX_AUTON_STEPS;
+        for (int i = 0; i < MAX_AUTON_STEPS; i++) {
+            t.step_value[r][i] = getF32(p);
+            p += 4;
+            ok = ok && std::isfinite(t.step_value[r][i]);
+        }
+    }
+    return ok && tunablesValid(t);
+}
+
+/**
+ * Load the tunables file, if there is a good one, and report on brain screen
+ * row 8. Call before prepareAutonPlans().
+ * @return whether the file was used
+ */
+bool loadTunables() {
+    encodeTunables(currentTunables(), tunables_saved);  // the defaults, until a file says otherwise
+    tunables_card = Brain.SDcard.isInserted();
+    Brain.Screen.setCursor(8,0);
+    Brain.Screen.clearLine();
+    if (!tunables_card) {
+        Brain.Screen.print("No SD card, using built-in tunables");
+        return false;
+    }
+    uint8_t buf[TUNABLES_FILE_BYTES + 1];  // one more, to notice a file that is too long
+    int len = Brain.SDcard.loadfile(TUNABLES_FILE, buf, sizeof(buf));
+    Tunables t;
+    if (len <= 0) {
+        Brain.Screen.print("No %s, using built-in tunables", TUNABLES_FILE);
+        return false;
+    }
+    if (!decodeTunables(buf, len, t)) {
+        Brain.Screen.print("%s unusable, using built-in tunables", TUNABLES_FILE);
+        return false;
+    }
+    applyTunables(t);
+    memcpy(tunables_saved, buf, TUNABLES_FILE_BYTES);
+    Brain.Screen.print("Tunables loaded from %s", TUNABLES_FILE);
+    return true;
+}
+
+/**
+ * Write tunables to the SD card if they differ from what is there. A write
+ * takes a few ms, so this is cheap when nothing changed. Values the next
+ * loadTunables() would reject are never written, since that would lose the
+ * whole file. Only one task may save.
+ * @return false if a write was needed and failed, or the values are out of range
+ */
+bool saveTunablesIfChanged(const Tunables &t) {
+    if (!tunables_card) return true;  // no card, or it was put in after startup and not read
+    if (!tunablesValid(t)) return false;
+    uint8_t buf[TUNABLES_FILE_BYTES];
+    encodeTunables(t, buf);
+    if (memcmp(buf, tunables_saved, TUNABLES_FILE_BYTES) == 0) return true;
+    if (Brain.SDcard.savefile(TUNABLES_FILE, buf, TUNABLES_FILE_BYTES) != TUNABLES_FILE_BYTES) return false;
+    memcpy(tunables_saved, buf, TUNABLES_FILE_BYTES);
+    return true;
+}
+
+bool saveTunablesIfChanged() { return saveTunablesIfChanged(currentTunables()); }
+
+// Hand the current tunables to the telemetry task, which saves them if they changed
+void publishTunables() {
+    tunables_state.write(currentTunables());
+}
+
+/**
+ * Telemetry log, to look at a match afterwards. Every driver control tick adds
+ * a TELEMETRY_RECORD_BYTES record to the block being filled in a ring of
+ * TELEMETRY_BLOCKS preallocated blocks, and a low-priority task appends each
+ * block to the log file on the SD card once it is full. The control loop only
+ * ever copies bytes into memory: if the card falls so far behind that the ring
+ * is full, records are dropped and counted rather than waited for. Records are
+ * numbered, so dropped ones show as gaps. The block being filled when the
+ * robot is switched off is lost, at most TELEMETRY_BLOCK_RECORDS ticks.
+ *
+ * Each run logs to the first free shs_logNN.bin, little-endian:
+ *   "SHSL", version (u16), record bytes (u16), tick period ms (u16)
+ * then records:
+ *   sequence number (u32), time us (u32, systemHighResolution(), wraps after
+ *   71 minutes), axis1, axis2 (i8), buttons (u16),
+ *   flags (u8: reversed, stopping mode << 1, spinner state << 3,
+ *          spinner ready << 5, recording << 6),
+ *   curve preset (u8), left and right power % (i8),
+ *   left and right velocity (i16, 0.1 rpm), spinner target and speed (i16, rpm),
+ *   left, right and spinner current (u8, 0.02 A),
+ *   hottest drive motor and spinner temperature (u8, C),
+ *   battery voltage (u16, mV), battery current (u8, 0.1 A)
+ * Next to it, shs_logNN.txt gets the loop timing totals (timingReport) every
+ * TIMING_DUMP_MS while driver control runs.
+ */
+const uint8_t TELEMETRY_MAGIC[4] = {'S', 'H', 'S', 'L'};
+const uint16_t TELEMETRY_VERSION = 2;  // 1 logged the time in whole ms
+const int TELEMETRY_HEADER_BYTES = 10;
+const int TELEMETRY_RECORD_BYTES = 32;
+const int TELEMETRY_BLOCK_RECORDS = 64;  // 320 ms of driving
+const int TELEMETRY_BLOCK_BYTES = TELEMETRY_BLOCK_RECORDS * TELEMETRY_RECORD_BYTES;
+const int TELEMETRY_BLOCKS = 32;         // 10 s of driving the card can fall behind by
+const int TELEMETRY_FLUSH_MS = 100;
+const int TELEMETRY_MAX_FILES = 100;
+
+static uint8_t telemetry_ring[TELEMETRY_BLOCKS][TELEMETRY_BLOCK_BYTES];
+static int telemetry_fill = 0;                       // records in the block being filled
+static std::atomic<uint32_t> telemetry_full(0);      // blocks filled, ever; written by the control loop
+static std::atomic<uint32_t> telemetry_flushed(0);   // blocks written out, ever; by the telemetry task
+static uint32_t telemetry_seq = 0;
+static uint32_t telemetry_dropped = 0;               // records
+static uint32_t telemetry_errors = 0;                // blocks the card did not take
+static char telemetry_file[16] = "";                 // empty - not logging
+static char timing_file[16] = "";                    // loop timing totals, next to the log
+
+int8_t clampI8(double v) { return (int8_t)fmax(-127., fmin(127., round(v))); }
+int16_t clampI16(double v) { return (int16_t)fmax(-32767., fmin(32767., round(v))); }
+uint8_t clampU8(double v) { return (uint8_t)fmax(0., fmin(255., round(v))); }
+
+// Add this tick's record to the log; never waits
+void telemetryRecord(int32_t axis1, int32_t axis2) {
+    if (!telemetry_file[0]) return;
+    uint32_t seq = telemetry_seq++;
+    uint32_t full = telemetry_full.load(std::memory_order_relaxed);
+    if (full - telemetry_flushed.load(std::memory_order_acquire) >= (uint32_t)TELEMETRY_BLOCKS) {
+        telemetry_dropped++;  // every block is waiting for the card
+        return;
+    }
+    uint8_t *p = telemetry_ring[full % TELEMETRY_BLOCKS] + telemetry_fill * TELEMETRY_RECORD_BYTES;
+    double spin_target = spinner_state == 1 ? spinner_rpm : (spinner_state == 3 ? -spinner_rpm : 0.);
+    putU32(p, seq);
+    putU32(p + 4, (uint32_t)vex::timer::systemHighResolution());
+    p[8] = (uint8_t)clampI8(axis1);
+    p[9] = (uint8_t)clampI8(axis2);
+    putU16(p + 10, pressedButtons());
+    p[12] = (uint8_t)((reversed ? 1 : 0) | stopping_mode_num << 1 | spinner_state << 3 |
+                      (spinner_ready ? 1 : 0) << 5 | (recording_on ? 1 : 0) << 6);
+    p[13] = (uint8_t)curve_preset;
+    p[14] = (uint8_t)clampI8(cur_lp);
+    p[15] = (uint8_t)clampI8(cur_rp);
+    putU16(p + 16, (uint16_t)clampI16(lmotors.velocity(velocityUnits::rpm) * 10));
+    putU16(p + 18, (uint16_t)clampI16(rmotors.velocity(velocityUnits::rpm) * 10));
+    putU16(p + 20, (uint16_t)clampI16(spin_target));
+    putU16(p + 22, (uint16_t)clampI16(Motor05sp.velocity(velocityUnits::rpm)));
+    p[24] = clampU8(lmotors.current() / 0.02);
+    p[25] = clampU8(rmotors.current() / 0.02);
+    p[26] = clampU8(Motor05sp.current(currentUnits::amp) / 0.02);
+    p[27] = clampU8(fmax(lmotors.temperature(), rmotors.temperature()));
+    p[28] = clampU8(Motor05sp.temperature(temperatureUnits::celsius));
+    putU16(p + 29, (uint16_t)fmin(65535., Brain.Battery.voltage(voltageUnits::mV)));
+    p[31] = clampU8(Brain.Battery.current(currentUnits::amp) * 10);
+    if (++telemetry_fill == TELEMETRY_BLOCK_RECORDS) {
+        telemetry_fill = 0;
+        telemetry_full.store(full + 1, std::memory_order_release);
+    }
+}
+
+int telemetry_loop() {
+    static char report[2048];
+    uint32_t reported_ticks = 0;
+    double reported_ms = Brain.timer(timeUnits::msec);
+    double tunables_checked_ms = reported_ms;
+    while (true) {
+        uint32_t flushed = telemetry_flushed.load(std::memory_order_relaxed);
+        while (flushed != telemetry_full.load(std::memory_order_acquire)) {
+            uint8_t *block = telemetry_ring[flushed % TELEMETRY_BLOCKS];
+            if (Brain.SDcard.appendfile(telemetry_file, block, TELEMETRY_BLOCK_BYTES) != TELEMETRY_BLOCK_BYTES) {
+                telemetry_errors++;  // card full or pulled out; move on rather than stall the ring
+            }
+            telemetry_flushed.store(++flushed, std::memory_order_release);
+        }
+        if (Brain.timer(timeUnits::msec) - tunables_checked_ms >= TUNABLES_CHECK_MS) {
+            saveTunablesIfChanged(tunables_state.read());
+            tunables_checked_ms = Brain.timer(timeUnits::msec);
+        }
+        saveRecordingIfDue();
+        // Loop timing totals, when driver control has run since the last time
+        if (timing_file[0] && Brain.timer(timeUnits::msec) - reported_ms >= TIMING_DUMP_MS) {
+            reported_ms = Brain.timer(timeUnits::msec);
+            TimingTotals totals = drive_timing_totals.read();
+            totals.stage[STAGE_SCREEN] = screen_timing_totals.read();
+            if (totals.stage[STAGE_TICK].count != reported_ticks) {
+                reported_ticks = totals.stage[STAGE_TICK].count;
+                int len = timingReport(totals, report, sizeof(report));
+                Brain.SDcard.savefile(timing_file, (uint8_t *)report, len);
+            }
+        }
+        task::sleep(TELEMETRY_FLUSH_MS);
+    }
+    return 0;
+}
+
+// Start a new log file and the task that writes it, the tunables and recordings; reports on brain screen row 11
+void startTelemetry() {
+    Brain.Screen.setCursor(11,0);
+    Brain.Screen.clearLine();
+    if (!Brain.SDcard.isInserted()) {
+        Brain.Screen.print("No SD card, not logging");
+        return;
+    }
+    static vex::task telemetry(telemetry_loop, vex::task::taskPriorityLow);
+    char name[sizeof(telemetry_file)];
+    for (int i = 0; i < TELEMETRY_MAX_FILES; i++) {
+        snprintf(name, sizeof(name), "shs_log%02d.bin", i);
+        if (!Brain.SDcard.exists(name)) break;  // all taken: the last one is overwritten
+    }
+    uint8_t header[TELEMETRY_HEADER_BYTES];
+    memcpy(header, TELEMETRY_MAGIC, 4);
+    putU16(header + 4, TELEMETRY_VERSION);
+    putU16(header + 6, TELEMETRY_RECORD_BYTES);
+    putU16(header + 8, DRIVE_PERIOD_MS);
+    if (Brain.SDcard.savefile(name, header, TELEMETRY_HEADER_BYTES) != TELEMETRY_HEADER_BYTES) {
+        Brain.Screen.print("Cannot write %s, not logging", name);
+        return;
+    }
+    strcpy(telemetry_file, name);
+    strcpy(timing_file, name);
+    strcpy(strrchr(timing_file, '.'), ".txt");
+    Brain.Screen.print("Logging to %s", telemetry_file);
 }
 
 /**
@@ -352,65 +2325,257 @@ void displayCurrentAutonState() {
             Brain.Screen.setCursor(2,0);
             Brain.Screen.clearLine();
             Brain.Screen.print("Robot will now do nothing");
+            break;
+        case REPLAY_AUTON_STATE:
+            Brain.Screen.setCursor(1,0);
+            Brain.Screen.clearLine();
+            Brain.Screen.print("A6 - Replay driver recording");
+            
+            Brain.Screen.setCursor(2,0);
+            Brain.Screen.clearLine();
+            Brain.Screen.print(routine_writer.count > 0 ? "Start where the recording started" : "Nothing recorded, L1 to record");
+            break;
+        case CHARACTERIZE_AUTON_STATE:
+            Brain.Screen.setCursor(1,0);
+            Brain.Screen.clearLine();
+            Brain.Screen.print("A7 - Characterize drive");
+            
+            Brain.Screen.setCursor(2,0);
+            Brain.Screen.clearLine();
+            Brain.Screen.print("Needs 1.5 m clear in front and behind, takes 35 s");
+            break;
     }
+    Brain.Screen.setCursor(3,0);
+    Brain.Screen.clearLine();
+    Brain.Screen.print("Press screen to toggle auton state");
     Brain.Screen.render();
 }
 
 /**
  * Runs when screen is pressed. Toggles the
- * auton state */
+ * auton state; the UI task shows it */
 void screenpressed(void) {
-    autonState = autonState % 5 + 1;
-    displayCurrentAutonState();
-    
-    Brain.Screen.setCursor(3,0);
+    autonState = autonState % CHARACTERIZE_AUTON_STATE + 1;
+}
+
+/**
+ * UI task. Screen output can be slow, so the control code does none: the
+ * driver control loop publishes a UiState snapshot every tick through a
+ * Seqlock, and ui_loop() draws the controller lines and the brain screen rows
+ * that change during a match from the latest snapshot every UI_PERIOD_MS.
+ * Only driver control publishes, so during autonomous the controller lines
+ * keep what they showed last.
+ */
+struct UiState {
+    bool print_info;
+    double px, py;
+    double smooth_power;
+    bool reversed;
+    int stopping_mode_num;
+    double lp, rp;
+    int spinner_state;
+    double spinner_rpm;
+    bool spinner_ready;
+    int spinner_jams;
+    double last_jam_ms;
+    uint32_t loop_windows;   // how many windows loop covers, to tell a new report
+    LoopStats loop;          // the last complete window
+    uint32_t telemetry_dropped;
+    uint32_t telemetry_errors;
+};
+
+static Seqlock<UiState> ui_state;
+
+void publishUiState() {
+    UiState s;
+    s.print_info = print_info;
+    s.px = cur_px;
+    s.py = cur_py;
+    s.smooth_power = smooth_power;
+    s.reversed = reversed;
+    s.stopping_mode_num = stopping_mode_num;
+    s.lp = cur_lp;
+    s.rp = cur_rp;
+    s.spinner_state = spinner_state;
+    s.spinner_rpm = spinner_rpm;
+    s.spinner_ready = spinner_ready;
+    s.spinner_jams = spinner_jams;
+    s.last_jam_ms = last_jam_ms;
+    s.loop_windows = loop_windows;
+    s.loop = last_loop_stats;
+    s.telemetry_dropped = telemetry_dropped;
+    s.telemetry_errors = telemetry_errors;
+    ui_state.write(s);
+}
+
+void renderControllerLines(const UiState &s) {
+    if (s.print_info) {
+        controllerPrint(JOYSTICK_LINE, "J %4.0f %4.0f %3.2f", s.py, s.px, s.smooth_power);
+        controllerPrint(MOTOR_LINE, "M: %c %c %3.0f%% %3.0f%%", (s.reversed ? 'R' : 'F'),
+                        stopping_mode_char[s.stopping_mode_num], s.lp, s.rp);
+    } else {
+        controllerPrint(JOYSTICK_LINE, "");
+        controllerPrint(MOTOR_LINE, "");
+    }
+    controllerPrint(SPINNER_LINE, "S: %s %4.0f rpm %s",
+                    (s.spinner_state % 2 == 0 ? "OFF" : (s.spinner_state == 1 ? "FWD" : "REV")),
+                    s.spinner_rpm, s.spinner_ready ? "RDY" : "");
+}
+
+/**
+ * Loop timing over the last window on brain screen rows 10 and 12: the tick
+ * period and the work in a tick (average/max), then the stages that took the
+ * largest share of the work. The totals file has every stage.
+ */
+void displayLoopTiming(const LoopStats &l) {
+    const TimingWindow &tick = l.stage[STAGE_TICK];
+    const TimingWindow &period = l.period;
+    Brain.Screen.setCursor(10,0);
     Brain.Screen.clearLine();
-    Brain.Screen.print("Press screen to toggle auton state");
+    Brain.Screen.print("Loop %.2f ms, max %.1f, jit %.2f; tick %lu/%lu us",
+                       period.count ? period.total_us / 1000. / period.count : 0., period.max_us / 1000.,
+                       timingJitter(period.count, period.total_us, period.total_sq) / 1000.,
+                       (unsigned long)(tick.total_us / tick.count), (unsigned long)tick.max_us);
+    Brain.Screen.setCursor(12,0);
+    Brain.Screen.clearLine();
+    Brain.Screen.print("Most time:");
+    bool shown[NUM_STAGES] = {false};
+    for (int i = 0; i < 3; i++) {
+        int top = -1;
+        for (int st = 0; st < STAGE_TICK; st++) {
+            if (!shown[st] && (top < 0 || l.stage[st].total_us > l.stage[top].total_us)) top = st;
+        }
+        shown[top] = true;
+        Brain.Screen.print("%s %s %.0f%%", i ? "," : "", stage_names[top],
+                           100. * l.stage[top].total_us / fmax(1., tick.total_us));
+    }
+}
+
+int ui_loop() {
+    int shown_auton_state = -1;
+    int shown_jams = 0;
+    uint32_t shown_loop_windows = 0;
+    uint32_t shown_dropped = 0, shown_errors = 0;
+    while (true) {
+        {  // the drawing is timed, not the sleep
+            StageTimer timer(STAGE_SCREEN, screen_timing);
+            UiState s = ui_state.read();
+            renderControllerLines(s);
+            controllerScreenRefill();
+            controllerScreenFlush();
+        
+            bool drawn = false;
+            if (autonState != shown_auton_state) {
+                shown_auton_state = autonState;
+                displayCurrentAutonState();
+            }
+            if (s.spinner_jams != shown_jams) {
+                shown_jams = s.spinner_jams;
+                Brain.Screen.setCursor(9,0);
+                Brain.Screen.clearLine();
+                Brain.Screen.print("Spinner jams: %d, last at %.1f s", s.spinner_jams, s.last_jam_ms / 1000.);
+                drawn = true;
+            }
+            if (s.loop_windows != shown_loop_windows && s.loop.stage[STAGE_TICK].count > 0) {
+                shown_loop_windows = s.loop_windows;
+                s.loop.stage[STAGE_SCREEN] = screen_timing.window.stage[STAGE_SCREEN];
+                memset(&screen_timing.window, 0, sizeof(screen_timing.window));
+                displayLoopTiming(s.loop);
+                drawn = true;
+            }
+            if (s.telemetry_dropped != shown_dropped || s.telemetry_errors != shown_errors) {
+                shown_dropped = s.telemetry_dropped;
+                shown_errors = s.telemetry_errors;
+                Brain.Screen.setCursor(11,0);
+                Brain.Screen.clearLine();
+                Brain.Screen.print("Logging to %s: %lu records dropped, %lu blocks lost", telemetry_file,
+                                   (unsigned long)s.telemetry_dropped, (unsigned long)s.telemetry_errors);
+                drawn = true;
+            }
+            if (drawn) Brain.Screen.render();
+        }
+        screen_timing_totals.write(screen_timing.totals.stage[STAGE_SCREEN]);
+        task::sleep(UI_PERIOD_MS);
+    }
+    return 0;
+}
+
+void start_ui() {
+    static vex::task ui(ui_loop, vex::task::taskPriorityLow);
 }
 
 void pre_auton() {
+    start_odometry();
+    start_spinner_control();
+    loadTunables();
+    prepareAutonPlans();
+    publishTunables();
+    loadRecording();
+    startTelemetry();
     // Set up action button bindings to functions
-    Controller1.ButtonX.pressed(spinner_toggle);
-    Controller1.ButtonUp.pressed(spinner_rpm_up);
-    Controller1.ButtonDown.pressed(spinner_rpm_down);        
-    Controller1.ButtonB.pressed(reverse_toggle);
-    Controller1.ButtonRight.pressed(smooth_power_up);
-    Controller1.ButtonLeft.pressed(smooth_power_down);
-    Controller1.ButtonY.pressed(toggle_print_info);
-    Controller1.ButtonA.pressed(stopping_mode_toggle);
-    // Set up initial screen
-    Controller1.Screen.clearScreen();
-    print_motor_line();
-    print_spin();
+    for (int i = 0; i < NUM_BUTTON_BINDINGS; i++) {
+        button_bindings[i].button->pressed(button_bindings[i].on_press);
+    }
+    Controller1.ButtonL1.pressed(record_toggle);
+    // Set up initial screen; the UI task draws the rest
+    controllerScreenClear();
     Brain.Screen.render(true, false); // Enable double buffering for smoother drawing
     Brain.Screen.pressed(screenpressed);
-    
-    /* Display initial text */
-    displayCurrentAutonState();
-    Brain.Screen.setCursor(3,0);
-    Brain.Screen.clearLine();
-    Brain.Screen.print("Press screen to toggle auton state");
+    publishUiState();
+    start_ui();
 }
 
 void autonomous(void){
-    switch (autonState) {
-        case 1: auton12(true);
-                break;
-        case 2: auton12(false);
-                break;
-        case 3: auton34(true);
-                break;
-        case 4: auton34(false);
-                break;
-		case 5: break;
+    Pose start = {0., 0., 0.};
+    setPose(start);  // field position is measured from where autonomous starts
+    if (autonState >= 1 && autonState <= NUM_AUTON_PLANS) {
+        runAutonPlan(auton_plans[autonState - 1]);
+    } else if (autonState == REPLAY_AUTON_STATE) {
+        playRecording();
+    } else if (autonState == CHARACTERIZE_AUTON_STATE) {
+        characterizeDrive();
+        publishTunables();
     }
 }
 
+// One pass of the driver control loop
+void driver_tick() {
+    StageTimer tick(STAGE_TICK);
+    StageTimer timer(STAGE_INPUT);
+    // Drive code
+    int32_t px = Controller1.Axis1.value();  //Gets the value of the joystick axis on a scale from -127 to 127.
+    int32_t py = Controller1.Axis2.value();
+    timer.next(STAGE_RECORD);
+    recordSample(px, py);
+    arcadedrive(px, py);  // times its own stages
+    timer.next(STAGE_LOG);
+    telemetryRecord(px, py);
+    timer.next(STAGE_PUBLISH);
+    if (tunables_changed.exchange(false)) publishTunables();  // curve or spinner speed changed on the controller
+    publishUiState();
+}
+
 void user_control(void){
+    uint64_t window_start = vex::timer::systemHighResolution();
+    uint64_t last_tick = 0;
     while(true) {
-        // Drive code
-        arcadedrive();
-        vex::task::sleep(5); //Sleep the task for a short amount of time to prevent wasted resources. 
+        uint64_t tick = vex::timer::systemHighResolution();
+        if (last_tick) {
+            uint32_t period = (uint32_t)(tick - last_tick);
+            timingAdd(drive_timing.totals.period, drive_timing.window.period, period, periodBucket(period));
+        }
+        last_tick = tick;
+        driver_tick();
+        
+        // Hand the window over to the brain screen and the totals to the telemetry task
+        if (tick - window_start >= LOOP_STATS_MS * 1000u) {
+            last_loop_stats = drive_timing.window;
+            loop_windows++;
+            memset(&drive_timing.window, 0, sizeof(drive_timing.window));
+            drive_timing_totals.write(drive_timing.totals);
+            window_start = tick;
+        }
+        vex::task::sleep(DRIVE_PERIOD_MS); //Sleep the task for a short amount of time to prevent wasted resources. 
     }
 }
 
@@ -418,5 +2583,6 @@ int main() {
     pre_auton();//setup
     Competition.autonomous(autonomous);
     Competition.drivercontrol(user_control);
+    return 0;
 }
 
@@ -29,10 +29,167 @@ void toggle_print_info(){
 
 
 // Drive code
-motor lmotors[] {Motor11dl, Motor01dl, Motor03dl};
-motor rmotors[] {Motor04dr, Motor16dr, Motor02dr};
 const int NUM_MOTORS = 3; // per side
 
+/**
+ * Motor command cache. Remembers the last spin/stop/setStopping command sent to
+ * each smart port and drops a new one that would not change anything, so the
+ * drive loop does not resend the same messages to every motor every tick.
+ * All motor commands in this program go through cached_spin/cached_stop/
+ * cached_set_stopping so the cache always matches what the motors were told.
+ */
+const double SPIN_TOLERANCE = 0.5;  // velocity change (pct or rpm) too small to resend
+const int NUM_PORTS = 21;
+
+struct MotorCommand {
+    bool known;       // a spin or stop has been sent
+    bool spinning;    // last command was spin, otherwise stop
+    directionType dir;
+    double velocity;
+    int units;        // 0 - percent, 1 - rpm, 2 - dps
+    bool brake_known; // a stopping mode has been sent
+    brakeType brake;
+};
+static MotorCommand motor_cmd[NUM_PORTS];  // all unknown at start
+static unsigned long motor_msgs_sent = 0;
+static unsigned long motor_msgs_saved = 0;  // commands dropped as redundant
+
+// Record a spin command; returns false if the motor is already doing it
+bool spin_changed(motor &m, directionType dir, double velocity, int units) {
+    MotorCommand &c = motor_cmd[m.index()];
+    if (c.known && c.spinning && c.dir == dir && c.units == units && fabs(c.velocity - velocity) < SPIN_TOLERANCE) {
+        motor_msgs_saved++;
+        return false;
+    }
+    c.known = true;
+    c.spinning = true;
+    c.dir = dir;
+    c.velocity = velocity;
+    c.units = units;
+    motor_msgs_sent++;
+    return true;
+}
+
+void cached_spin(motor &m, directionType dir, double velocity, percentUnits units) {
+    if (spin_changed(m, dir, velocity, 0)) m.spin(dir, velocity, units);
+}
+
+void cached_spin(motor &m, directionType dir, double velocity, velocityUnits units) {
+    int u = units == velocityUnits::rpm ? 1 : (units == velocityUnits::dps ? 2 : 0);
+    if (spin_changed(m, dir, velocity, u)) m.spin(dir, velocity, units);
+}
+
+void cached_stop(motor &m, brakeType mode) {
+    MotorCommand &c = motor_cmd[m.index()];
+    if (c.known && !c.spinning && c.brake_known && c.brake == mode) {
+        motor_msgs_saved++;
+        return;
+    }
+    c.known = true;
+    c.spinning = false;
+    c.brake_known = true;
+    c.brake = mode;  // stop(mode) also sets the stopping mode
+    motor_msgs_sent++;
+    m.stop(mode);
+}
+
+void cached_stop(motor &m) {
+    MotorCommand &c = motor_cmd[m.index()];
+    if (c.brake_known) {
+        cached_stop(m, c.brake);
+        return;
+    }
+    c.known = true;
+    c.spinning = false;
+    motor_msgs_sent++;
+    m.stop();
+}
+
+void cached_set_stopping(motor &m, brakeType mode) {
+    MotorCommand &c = motor_cmd[m.index()];
+    if (c.brake_known && c.brake == mode) {
+        motor_msgs_saved++;
+        return;
+    }
+    c.brake_known = true;
+    c.brake = mode;
+    motor_msgs_sent++;
+    m.setStopping(mode);
+}
+
+const double MOTOR_MSGS_PRINT_MS = 1000;  // the counts are printed at most this often
+static double motor_msgs_printed_ms = -1e9;
+
+// Show how many motor commands were sent and how many were dropped, on brain screen row 4
+void print_motor_msgs() {
+    double now = Brain.timer(vex::timeUnits::msec);
+    if (now - motor_msgs_printed_ms < MOTOR_MSGS_PRINT_MS) return;
+    motor_msgs_printed_ms = now;
+    unsigned long total = motor_msgs_sent + motor_msgs_saved;
+    Brain.Screen.setCursor(4,0);
+    Brain.Screen.clearLine();
+    Brain.Screen.print("Motor msgs: %lu sent, %lu saved (%.0f%%)", motor_msgs_sent, motor_msgs_saved,
+                       total ? 100. * motor_msgs_saved / total : 0.);
+    Brain.Screen.render();
+}
+
+/**
+ * Motors that are driven together, e.g. one side of the drive. Holds pointers to
+ * the motors declared in robot-config.h instead of copies, and applies each
+ * command or sensor read to the whole group in one call.
+ */
+class MotorGroup {
+public:
+    MotorGroup(motor &m1, motor &m2, motor &m3) : m{&m1, &m2, &m3} {}
+
+    motor &operator[](int i) { return *m[i]; }
+
+    void spin(directionType dir, double velocity, percentUnits units) {
+        for (int i = 0; i < NUM_MOTORS; i++) cached_spin(*m[i], dir, velocity, units);
+    }
+
+    void stop() {
+        for (int i = 0; i < NUM_MOTORS; i++) cached_stop(*m[i]);
+    }
+
+    void stop(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) cached_stop(*m[i], mode);
+    }
+
+    void setStopping(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) cached_set_stopping(*m[i], mode);
+    }
+
+    void resetRotation() {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->resetRotation();
+    }
+
+    // Averages over the group
+    double power() {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->power(powerUnits::watt);
+        return sum / NUM_MOTORS;
+    }
+
+    double velocity(velocityUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->velocity(units);
+        return sum / NUM_MOTORS;
+    }
+
+    double rotation(rotationUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->rotation(units);
+        return sum / NUM_MOTORS;
+    }
+
+private:
+    motor *m[NUM_MOTORS];
+};
+
+MotorGroup lmotors(Motor11dl, Motor01dl, Motor03dl);
+MotorGroup rmotors(Motor04dr, Motor16dr, Motor02dr);
+
 /**
  * Reversing of motors. If reversed is true then front and back of the robot are reversed.
  */
@@ -58,17 +215,13 @@ void print_motor_line() {
 }
 
 void spin_motors(double lp, double rp) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(vex::directionType::fwd, lp, percentUnits::pct);
-        rmotors[i].spin(vex::directionType::fwd, rp, percentUnits::pct);
-    }
+    lmotors.spin(vex::directionType::fwd, lp, percentUnits::pct);
+    rmotors.spin(vex::directionType::fwd, rp, percentUnits::pct);
 }
 
 void set_stopping_mode_for_motors(brakeType mode) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].setStopping(mode);
-        rmotors[i].setStopping(mode);
-    }
+    lmotors.setStopping(mode);
+    rmotors.setStopping(mode);
 }
 
 void reverse_toggle() {
@@ -89,47 +242,38 @@ void stopping_mode_toggle() {
  * Stop all wheel motors 
  */
 void stopAllMotors() {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].stop();
-        rmotors[i].stop();
-    }
+    lmotors.stop();
+    rmotors.stop();
 }
 
 void stopAllMotors(brakeType bt) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].stop(bt);
-        rmotors[i].stop(bt);
-    }
-}
-
-void accelerateMotor(motor m, directionType dir) {
-    double pwr = (m.power(powerUnits::watt)/11)*100; //convert into %
-    if(pwr < 100) {
-        pwr += 10;
-    }
-    m.spin(dir, pwr, percentUnits::pct);
-}
-
-void accelerateAllMotors(bool left, directionType dir) {
-    if(left) {
-        for(int i = 0; i < 3; i++) {
-            accelerateMotor(lmotors[i], dir);
-        }
-    } else {
-        for(int i = 0; i < 3; i++) {
-            accelerateMotor(rmotors[i], dir);
-        }
-    }
+    lmotors.stop(bt);
+    rmotors.stop(bt);
 }
 
-double averagePower(bool left){
-    double avg = 0.0;
-    if(left) {
-        avg += ( lmotors[0].power(powerUnits::watt) + lmotors[1].power(powerUnits::watt) + lmotors[2].power(powerUnits::watt) ) / 3;
-    } else {
-        avg += ( lmotors[0].power(powerUnits::watt) + lmotors[1].power(powerUnits::watt) + lmotors[2].power(powerUnits::watt) ) / 3;
-    }
-    return avg;
+/**
+ * GTA-style drive. Holding a D-pad button ramps motor power at a fixed rate per
+ * elapsed millisecond, measured with the brain timer, so GTAdrive() never sleeps
+ * and every button is read on every pass through the control loop.
+ * Up/Down - speed up forward/backward, Left/Right - slow the left/right side
+ * towards reverse, L1 - cruise (keep current power), R1 - brake.
+ */
+const double GTA_ACCEL_RATE = 0.2;  // % power per ms while Up/Down is held (10% per 50 ms)
+const double GTA_TURN_RATE = 0.1;   // % power per ms while Left/Right is held (10% per 100 ms)
+const double GTA_MAX_STEP_MS = 50;  // longest time step applied at once, e.g. after a pause
+const double GTA_PRINT_MS = 200;    // while power ramps, the motor line is printed at most this often
+
+// 0 - keeping the last power (nothing held, or cruise), 1 - accelerating, 2 - braking
+enum GTAState { GTA_COAST, GTA_ACCEL, GTA_BRAKE };
+static GTAState gta_state = GTA_COAST;
+static double gta_last_ms = -1.;
+static double gta_printed_ms = -1e9;
+static bool gta_print_due = false;  // power changed since the motor line was printed
+
+// Move power towards the limit (+-100%) by rate * dt
+double ramp_power(double pwr, double rate, double dt) {
+    pwr += rate * dt;
+    return fmax(-100., fmin(100., pwr));
 }
 
 void GTAdrive() {
@@ -140,39 +284,66 @@ void GTAdrive() {
     bool brake = Controller1.ButtonR1.pressing();
     bool cruise = Controller1.ButtonL1.pressing();//locks motor speeds in place, should help with turns & adjustments
     
-    if(!cruise) {
-        if(fwd){
-            accelerateAllMotors(true, vex::directionType::fwd);
-            accelerateAllMotors(false, vex::directionType::fwd);
-            vex::task::sleep(50);
-        }
-        if(rev){
-            accelerateAllMotors(true, vex::directionType::fwd);
-            accelerateAllMotors(false, vex::directionType::fwd);
-            vex::task::sleep(50);
-        }
-        if(left) {
-            accelerateAllMotors(true, vex::directionType::rev);
-            vex::task::sleep(100);
-        }
-        if(right) {
-            accelerateAllMotors(false, vex::directionType::rev);
-            vex::task::sleep(100);
-        }
-    }
+    double now = Brain.timer(vex::timeUnits::msec);
+    double dt = gta_last_ms < 0 ? 0. : fmin(now - gta_last_ms, GTA_MAX_STEP_MS);
+    gta_last_ms = now;
     
-    double lpwr = averagePower(true);
-    double rpwr = averagePower(false);
-    double average_power = (lpwr + rpwr) / 2;
+    double lp = cur_lp;
+    double rp = cur_rp;
     
-    //Leveling out after a turn
-    if( (fwd || rev) && (!brake && !left && !right && lpwr != rpwr)) {
-        spin_motors(average_power, average_power);
-    }
+    GTAState last_state = gta_state;
     if(brake) {
-        stopAllMotors(stopping_mode[0]);//may skid but hopefully permits drifting
+        gta_state = GTA_BRAKE;
+    } else if(!cruise && (fwd || rev || left || right)) {
+        gta_state = GTA_ACCEL;
+    } else {
+        gta_state = GTA_COAST;
+    }
+    
+    switch (gta_state) {
+        case GTA_BRAKE:
+            lp = rp = 0.;
+            break;
+        case GTA_ACCEL:
+            if(fwd) {
+                lp = ramp_power(lp, GTA_ACCEL_RATE, dt);
+                rp = ramp_power(rp, GTA_ACCEL_RATE, dt);
+            }
+            if(rev) {
+                lp = ramp_power(lp, -GTA_ACCEL_RATE, dt);
+                rp = ramp_power(rp, -GTA_ACCEL_RATE, dt);
+            }
+            if(left) {
+                lp = ramp_power(lp, -GTA_TURN_RATE, dt);
+            }
+            if(right) {
+                rp = ramp_power(rp, -GTA_TURN_RATE, dt);
+            }
+            //Leveling out after a turn
+            if((fwd || rev) && !left && !right && lp != rp) {
+                lp = rp = (lp + rp) / 2;
+            }
+            break;
+        case GTA_COAST:
+            break;  // keep current power
     }
     
+    if(gta_state == GTA_BRAKE) {
+        stopAllMotors(stopping_mode[0]);//may skid but hopefully permits drifting
+    } else {
+        spin_motors(lp, rp);
+    }
+    if (lp != cur_lp || rp != cur_rp) {
+        cur_lp = lp;
+        cur_rp = rp;
+        gta_print_due = true;
+    }
+    // Power changes every pass while ramping; print when the ramp ends, or now and then during it
+    if (gta_print_due && (gta_state != last_state || now - gta_printed_ms >= GTA_PRINT_MS)) {
+        print_motor_line();
+        gta_print_due = false;
+        gta_printed_ms = now;
+    }
 }
 
 /**
@@ -193,9 +364,9 @@ void print_spin() {
 
 void set_spin() {
     if (spinner_state % 2 == 0) { // states 0 and 2
-        Motor05sp.stop(brakeType::coast);        
+        cached_stop(Motor05sp, brakeType::coast);        
     } else {
-        Motor05sp.spin((spinner_state == 1 ? directionType::fwd : directionType::rev), spinner_rpm, velocityUnits::rpm);//if equal to 1, rotate fwd, else rotate rev
+        cached_spin(Motor05sp, (spinner_state == 1 ? directionType::fwd : directionType::rev), spinner_rpm, velocityUnits::rpm);//if equal to 1, rotate fwd, else rotate rev
     }
 }
 
@@ -233,10 +404,8 @@ int autonState = 1;
  */
 void moveStraight (int power=100, bool fwd=true, int time=1000) {
     vex::directionType dir = fwd ? vex::directionType::fwd : vex::directionType::rev;
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dir, power, percentUnits::pct);
-        rmotors[i].spin(dir, power, percentUnits::pct);
-    }
+    lmotors.spin(dir, power, percentUnits::pct);
+    rmotors.spin(dir, power, percentUnits::pct);
     
     task::sleep(time);
     set_stopping_mode_for_motors(hold);
@@ -265,10 +434,8 @@ void rotate(int angle) {
     vex::directionType dirL = angle < 0 ? vex::directionType::fwd : vex::directionType::rev;
     vex::directionType dirR = angle > 0 ? vex::directionType::fwd : vex::directionType::rev;
     
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dirL, 100, percentUnits::pct);
-        rmotors[i].spin(dirR, 100, percentUnits::pct);
-    }
+    lmotors.spin(dirL, 100, percentUnits::pct);
+    rmotors.spin(dirR, 100, percentUnits::pct);
     /* Calculate time to rotate (Rotates at around 0.36 deg/ms) */
     int absAng = angle < 0 ? -angle : angle;
     int time = absAng / 9 * 25;
@@ -420,6 +587,7 @@ void user_control(void){
     while(true) {
         // Drive code
         GTAdrive();
+        print_motor_msgs();
         vex::task::sleep(5); //Sleep the task for a short amount of time to prevent wasted resources. 
     }
 }
@@ -428,5 +596,6 @@ int main() {
     pre_auton();//setup
 	Competition.autonomous(autonomous);
     Competition.drivercontrol(user_control);
+    return 0;
 }
 
@@ -406,5 +406,6 @@ int main() {
     pre_auton();//setup
     Competition.autonomous(autonomous);
     Competition.drivercontrol(user_control);
+    return 0;
 }
 
@@ -242,5 +242,6 @@ void user_control(void){
 int main() {
     pre_auton();//setup
     Competition.drivercontrol(user_control);
+    return 0;
 }
 
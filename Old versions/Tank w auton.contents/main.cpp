@@ -338,4 +338,5 @@ int main() {
     pre_auton();//setup
     Competition.autonomous(autonomous);
     Competition.drivercontrol(user_control);
+    return 0;
 }
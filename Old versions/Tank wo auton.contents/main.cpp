@@ -173,4 +173,5 @@ void user_control(void){
 int main() {
     pre_auton();//setup
     Competition.drivercontrol(user_control);
+    return 0;
 }
@@ -0,0 +1,427 @@
+/*
+ * Host-side parameter sweep for the autonomous routines of "Arcade Drive final".
+ *
+ * Runs a routine thousands of times on a simplified drivetrain model, each
+ * time with a different set of tunables (step distances and angles, and the
+ * drive and turn feedforward the robot believes in) and a different draw of
+ * the things that vary on a real field: battery charge, friction, motor
+ * strength, wheel slip and how much the wheels scrub in a turn. Every
+ * configuration sees the same draws, so they are compared on equal terms.
+ * Configurations are ranked by how far from the target the robot ends up,
+ * with a little weight on the time taken.
+ *
+ * The program is compiled in: routines come from its step tables and are
+ * planned by its own prepareAutonPlan() and driven by its own runPlanStep(),
+ * with the model standing in for the motors behind DriveIO, so the moves and
+ * their gains are the robot's. The model is far
+ * simpler than host/vex.cpp (each side obeys V = ks + kv * v + ka * a, with
+ * the robot's real constants, which are the configuration-0 ones plus noise)
+ * so that one run takes microseconds, and it has no shared state, so runs go
+ * on all cores.
+ *
+ * Build and run:
+ *   g++ -O2 -std=c++11 -Ihost host/auton_sweep.cpp host/vex.cpp -o auton_sweep -lpthread
+ *   ./auton_sweep [--routine 12|34] [--tunables FILE] [--configs N] [--trials N] [--threads N]
+ *                 [--seed N] [--top N] [--noise K] [--time-weight W] [--sweep name=lo:hi ...]
+ * --tunables starts from a tunables file (see tunables_tool) instead of the
+ * built-in values, as the robot does when the SD card has one. Parameters are
+ * step1..stepN (step values as in the step table) and drive_ks, drive_kv,
+ * drive_ka, turn_ks, turn_kv, turn_ka. Without --sweep, every step value is
+ * swept +/-10%.
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Model */
+const double PHYSICS_STEP_S = 0.001;
+
+/* Ranking */
+const double HEADING_WEIGHT = 0.3;     // m of endpoint error per radian of heading error
+
+/* Everything a configuration can change, all of it in the tunables file */
+struct Tuning {
+    double step_value[MAX_AUTON_STEPS];
+    DriveFeedforward drive_ff;
+    DriveFeedforward turn_ff;
+};
+
+struct Param {
+    std::string name;
+    double lo, hi;
+};
+
+double *paramRef(Tuning &t, const std::string &name) {
+    if (name == "drive_ks") return &t.drive_ff.ks;
+    if (name == "drive_kv") return &t.drive_ff.kv;
+    if (name == "drive_ka") return &t.drive_ff.ka;
+    if (name == "turn_ks") return &t.turn_ff.ks;
+    if (name == "turn_kv") return &t.turn_ff.kv;
+    if (name == "turn_ka") return &t.turn_ff.ka;
+    if (name.compare(0, 4, "step") == 0) {
+        int i = atoi(name.c_str() + 4) - 1;
+        if (i >= 0 && i < MAX_AUTON_STEPS) return &t.step_value[i];
+    }
+    return nullptr;
+}
+
+/**
+ * Plan a routine with a configuration's tunables, for the red alliance, by
+ * the program's own prepareAutonPlan(). Changes the routine's table and the
+ * program's feedforward while it runs, so only call it from one thread.
+ * @return false if the configuration makes the routine invalid
+ */
+bool planRoutine(AutonStep *routine, const Tuning &t, AutonPlan &plan) {
+    plan.valid = false;
+    if (!feedforwardValid(t.drive_ff) || !feedforwardValid(t.turn_ff)) return false;
+    AutonStep saved[MAX_AUTON_STEPS];
+    DriveFeedforward saved_drive = drive_ff, saved_turn = turn_ff;
+    int n = routineStepCount(routine);
+    for (int i = 0; i < n; i++) {
+        saved[i] = routine[i];
+        routine[i].value = t.step_value[i];
+    }
+    drive_ff = t.drive_ff;
+    turn_ff = t.turn_ff;
+    bool ok = prepareAutonPlan(routine, true, plan);
+    for (int i = 0; i < n; i++) routine[i] = saved[i];
+    drive_ff = saved_drive;
+    turn_ff = saved_turn;
+    return ok;
+}
+
+// Where the planned steps end up if driven perfectly
+Pose idealEnd(const AutonPlan &plan) {
+    Pose p = {0., 0., 0.};
+    for (const PlanStep *ps = plan.steps; ps->step.type != STEP_END; ps++) {
+        const AutonStep &s = ps->step;
+        if (s.type == STEP_STRAIGHT) {
+            p.x += s.value * cos(p.theta);
+            p.y += s.value * sin(p.theta);
+        } else if (s.type == STEP_TURN) {
+            double turn = s.value * M_PI / 180.;  // turns in place go to the plan's heading, so whole degrees don't add up
+            if (isCorner(s)) {
+                double rho = s.radius * (turn < 0 ? -1. : 1.);  // signed radius
+                p.x += rho * (sin(p.theta + turn) - sin(p.theta));
+                p.y += rho * (cos(p.theta) - cos(p.theta + turn));
+            }
+            p.theta += turn;
+        }
+    }
+    return p;
+}
+
+/* What varies from run to run on a real field */
+struct Noise {
+    double battery;      // fraction of MAX_VOLTS the battery can still give
+    double gain[2];      // left/right motor strength
+    double friction;     // ks / the robot's usual ks (floor, wear)
+    double slip[2];      // fraction of wheel travel lost to slip
+    double track_scale;  // effective track width in turns / TRACK_WIDTH (wheel scrub)
+};
+
+Noise drawNoise(unsigned seed, int trial, double k) {
+    std::mt19937 rng(seed * 1000003u + (unsigned)trial);
+    std::uniform_real_distribution<double> u(0., 1.);
+    std::normal_distribution<double> n(0., 1.);
+    Noise nz;
+    nz.battery = 1. - k * 0.15 * u(rng);
+    nz.gain[0] = 1. + k * 0.03 * n(rng);
+    nz.gain[1] = 1. + k * 0.03 * n(rng);
+    nz.friction = 1. + k * 0.5 * (2 * u(rng) - 1);
+    nz.slip[0] = k * 0.02 * u(rng);
+    nz.slip[1] = k * 0.02 * u(rng);
+    nz.track_scale = 1. + k * 0.15 * u(rng);
+    return nz;
+}
+
+/* The simplified robot. Each side follows its voltage through the robot's
+ * real feedforward constants, the turn ones while the sides go opposite ways. */
+class Robot : public DriveIO {
+public:
+    Noise nz;
+    DriveFeedforward drive_ff, turn_ff;  // real constants, friction included
+    double volt[2];
+    bool holding;       // stopped in hold mode: brake to a stop and stay there
+    double speed[2];    // wheel surface speed, m/s
+    double encoder[2];  // wheel travel, m, as leftDistance()/rightDistance()
+    Pose pose;          // where the robot really is
+    double time_s;
+
+    Robot(const Noise &noise, const DriveFeedforward &drive, const DriveFeedforward &turn)
+        : nz(noise), drive_ff(drive), turn_ff(turn), holding(false), time_s(0.) {
+        drive_ff.ks *= nz.friction;
+        turn_ff.ks *= nz.friction;
+        for (int s = 0; s < 2; s++) volt[s] = speed[s] = encoder[s] = 0.;
+        pose.x = pose.y = pose.theta = 0.;
+    }
+
+    double left() { return encoder[0]; }
+    double right() { return encoder[1]; }
+    double speedPct() { return fmax(fabs(speed[0]), fabs(speed[1])) / DRIVE_MAX_SPEED * 100.; }
+    double heading() { return (encoder[1] - encoder[0]) / TRACK_WIDTH; }  // as the odometry's encoder heading
+
+    void volts(double left, double right) {
+        volt[0] = left;
+        volt[1] = right;
+        holding = false;
+    }
+
+    void hold() { holding = true; }
+    void wait(int ms) { advance(ms / 1000.); }
+
+    void advance(double seconds) {
+        for (double t = 0; t < seconds - 1e-9; t += PHYSICS_STEP_S) {
+            bool turning = holding ? speed[0] * speed[1] < 0 : volt[0] * volt[1] < 0;
+            const DriveFeedforward &ff = turning ? turn_ff : drive_ff;
+            double avail = MAX_VOLTS * nz.battery;
+            double ground[2];
+            for (int s = 0; s < 2; s++) {
+                double dir = speed[s] != 0 ? (speed[s] > 0 ? 1. : -1.) : (volt[s] > 0 ? 1. : -1.);
+                double v = holding ? -avail * dir : fmax(-avail, fmin(avail, volt[s])) * nz.gain[s];
+                if (speed[s] != 0 || (!holding && fabs(v) > ff.ks)) {
+                    double next = speed[s] + (v - ff.ks * dir - ff.kv * speed[s]) / ff.ka * PHYSICS_STEP_S;
+                    // friction and braking stop a wheel, they never turn it around
+                    speed[s] = speed[s] != 0 && next * speed[s] <= 0 ? 0. : next;
+                }
+                encoder[s] += speed[s] * PHYSICS_STEP_S;
+                ground[s] = speed[s] * (1. - nz.slip[s]);
+            }
+            double v = (ground[0] + ground[1]) / 2;
+            double w = (ground[1] - ground[0]) / (TRACK_WIDTH * nz.track_scale);
+            pose.theta += w * PHYSICS_STEP_S;
+            pose.x += v * cos(pose.theta) * PHYSICS_STEP_S;
+            pose.y += v * sin(pose.theta) * PHYSICS_STEP_S;
+        }
+        time_s += seconds;
+    }
+};
+
+struct RunResult {
+    double error;          // m from the target position
+    double heading_error;  // rad
+    double time_s;
+    bool timed_out;
+};
+
+// As runAutonPlan(), on a robot whose real constants are actual's with noise
+RunResult runRoutine(const AutonPlan &plan, const Tuning &t, const Tuning &actual, const Noise &nz,
+                     const Pose &target) {
+    Robot r(nz, actual.drive_ff, actual.turn_ff);
+    RunResult res = {0., 0., 0., false};
+    double heading = 0.;
+    for (const PlanStep *ps = plan.steps; ps->step.type != STEP_END; ps++) {
+        if (!runPlanStep(r, t.drive_ff, t.turn_ff, *ps, heading)) res.timed_out = true;
+    }
+    res.error = hypot(r.pose.x - target.x, r.pose.y - target.y);
+    res.heading_error = fabs(remainder(r.pose.theta - target.theta, 2 * M_PI));
+    res.time_s = r.time_s;
+    return res;
+}
+
+struct ConfigResult {
+    bool valid;
+    double score;
+    double mean_error, p95_error, mean_heading_error, mean_time_s;
+    int timeouts;
+};
+
+/* Work-stealing scheduler. Each worker starts with its own block of jobs and
+ * takes from the back of its queue; once that is empty it steals from the
+ * front of the others', so workers that draw short jobs are never left idle. */
+class WorkQueues {
+public:
+    WorkQueues(int workers, int jobs) : n(workers), queues(new Queue[workers]) {
+        for (int j = 0; j < jobs; j++) queues[(long)j * workers / jobs].jobs.push_back(j);
+    }
+
+    bool next(int worker, int &job) {
+        for (int k = 0; k < n; k++) {
+            Queue &q = queues[(worker + k) % n];
+            std::lock_guard<std::mutex> lk(q.lock);
+            if (q.jobs.empty()) continue;
+            if (k == 0) {
+                job = q.jobs.back();
+                q.jobs.pop_back();
+            } else {
+                job = q.jobs.front();
+                q.jobs.pop_front();
+            }
+            return true;
+        }
+        return false;  // nothing spawns new jobs, so empty queues mean done
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<int> jobs;
+    };
+    int n;
+    std::unique_ptr<Queue[]> queues;
+};
+
+int main(int argc, char **argv) {
+    int routine_id = 34, num_configs = 2000, trials = 16, top = 10;
+    int threads = (int)std::thread::hardware_concurrency();
+    unsigned seed = 1;
+    double noise = 1., time_weight = 0.02;
+    std::vector<Param> params;
+    const char *tunables_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : "";
+        if (a == "--routine") routine_id = atoi(v);
+        else if (a == "--tunables") tunables_path = v;
+        else if (a == "--configs") num_configs = atoi(v);
+        else if (a == "--trials") trials = atoi(v);
+        else if (a == "--threads") threads = atoi(v);
+        else if (a == "--seed") seed = (unsigned)atoi(v);
+        else if (a == "--top") top = atoi(v);
+        else if (a == "--noise") noise = atof(v);
+        else if (a == "--time-weight") time_weight = atof(v);
+        else if (a == "--sweep") {
+            std::string s = v;
+            size_t eq = s.find('='), colon = s.find(':');
+            if (eq == std::string::npos || colon == std::string::npos || colon < eq) {
+                printf("bad --sweep %s, expected name=lo:hi\n", v);
+                return 1;
+            }
+            Param p = {s.substr(0, eq), atof(s.substr(eq + 1).c_str()), atof(s.substr(colon + 1).c_str())};
+            params.push_back(p);
+        } else {
+            printf("unknown option %s\n", a.c_str());
+            return 1;
+        }
+        i++;
+    }
+    if (routine_id != 12 && routine_id != 34) {
+        printf("routine must be 12 or 34\n");
+        return 1;
+    }
+    threads = std::max(1, threads);
+    num_configs = std::max(1, num_configs);
+    trials = std::max(1, trials);
+
+    if (tunables_path) {
+        uint8_t buf[TUNABLES_FILE_BYTES + 1];
+        FILE *f = fopen(tunables_path, "rb");
+        int len = f ? (int)fread(buf, 1, sizeof(buf), f) : 0;
+        if (f) fclose(f);
+        Tunables file;
+        if (!decodeTunables(buf, len, file)) {
+            printf("%s missing or unusable\n", tunables_path);
+            return 1;
+        }
+        applyTunables(file);
+    }
+
+    AutonStep *routine = auton_routines[routine_id == 12 ? 0 : 1];
+    Tuning base;
+    base.drive_ff = drive_ff;
+    base.turn_ff = turn_ff;
+    int num_steps = routineStepCount(routine);
+    for (int i = 0; i < MAX_AUTON_STEPS; i++) base.step_value[i] = i < num_steps ? routine[i].value : 0.;
+    if (params.empty()) {
+        for (int i = 0; i < num_steps; i++) {
+            double v = base.step_value[i];
+            Param p = {"step" + std::to_string(i + 1), v - 0.1 * fabs(v), v + 0.1 * fabs(v)};
+            params.push_back(p);
+        }
+    }
+    for (const Param &p : params) {
+        Tuning probe = base;
+        if (!paramRef(probe, p.name) || (p.name.compare(0, 4, "step") == 0 && atoi(p.name.c_str() + 4) > num_steps)) {
+            printf("unknown parameter %s\n", p.name.c_str());
+            return 1;
+        }
+    }
+
+    // The target is where the program's own routine would end if driven perfectly
+    AutonPlan plan;
+    planRoutine(routine, base, plan);
+    Pose target = idealEnd(plan);
+
+    // Configuration 0 is the program as it is, on a robot that really is as it believes;
+    // the rest are random within the ranges
+    std::vector<Tuning> configs(num_configs, base);
+    std::mt19937 rng(seed);
+    for (int c = 1; c < num_configs; c++) {
+        for (const Param &p : params) {
+            *paramRef(configs[c], p.name) = std::uniform_real_distribution<double>(p.lo, p.hi)(rng);
+        }
+    }
+    // prepareAutonPlan() reads the program's globals, so plan every configuration here
+    std::vector<AutonPlan> plans(num_configs);
+    for (int c = 0; c < num_configs; c++) planRoutine(routine, configs[c], plans[c]);
+    std::vector<Noise> noises(trials);
+    for (int i = 0; i < trials; i++) noises[i] = drawNoise(seed, i, noise);
+
+    std::vector<ConfigResult> results(num_configs);
+    WorkQueues work(threads, num_configs);
+    std::vector<std::thread> pool;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int w = 0; w < threads; w++) {
+        pool.push_back(std::thread([&, w] {
+            std::vector<double> errors(trials);
+            int c;
+            while (work.next(w, c)) {
+                ConfigResult &res = results[c];
+                memset(&res, 0, sizeof(res));
+                res.valid = plans[c].valid;
+                if (!res.valid) continue;
+                for (int i = 0; i < trials; i++) {
+                    RunResult run = runRoutine(plans[c], configs[c], base, noises[i], target);
+                    errors[i] = run.error;
+                    res.mean_error += run.error / trials;
+                    res.mean_heading_error += run.heading_error / trials;
+                    res.mean_time_s += run.time_s / trials;
+                    res.timeouts += run.timed_out;
+                }
+                std::sort(errors.begin(), errors.end());
+                res.p95_error = errors[std::min(trials - 1, (int)ceil(0.95 * trials) - 1)];
+                res.score = res.mean_error + HEADING_WEIGHT * res.mean_heading_error + time_weight * res.mean_time_s;
+            }
+        }));
+    }
+    for (std::thread &t : pool) t.join();
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int> order;
+    for (int c = 0; c < num_configs; c++) {
+        if (results[c].valid) order.push_back(c);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return results[a].score < results[b].score; });
+
+    printf("routine %d: %d configs x %d trials = %d runs on %d threads in %.2f s\n", routine_id, num_configs, trials,
+           num_configs * trials, threads, wall_s);
+    printf("target x %.3f m, y %.3f m, heading %.1f deg; %d configs invalid\n", target.x, target.y,
+           target.theta * 180. / M_PI, num_configs - (int)order.size());
+    printf("robot drive ks %.2f kv %.2f ka %.2f, turn ks %.2f kv %.2f ka %.2f (%s)\n", base.drive_ff.ks,
+           base.drive_ff.kv, base.drive_ff.ka, base.turn_ff.ks, base.turn_ff.kv, base.turn_ff.ka,
+           tunables_path ? tunables_path : "built-in tunables");
+    printf("rank  score  err(m)  p95(m)  hdg(deg)  time(s)  t/o ");
+    for (const Param &p : params) printf(" %8s", p.name.c_str());
+    printf("\n");
+    for (int r = 0; r < (int)order.size(); r++) {
+        int c = order[r];
+        if (r >= top && c != 0) continue;
+        const ConfigResult &res = results[c];
+        printf("%4d %6.3f  %6.3f  %6.3f  %8.2f  %7.2f  %3d ", r + 1, res.score, res.mean_error, res.p95_error,
+               res.mean_heading_error * 180. / M_PI, res.mean_time_s, res.timeouts);
+        for (const Param &p : params) printf(" %8.3f", *paramRef(configs[c], p.name));
+        printf(c == 0 ? "  (program)\n" : "\n");
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Host-side microbenchmark for the joystick response curve of
+ * "Arcade Drive final" ("revised-tank-drive" has the same preset tables).
+ *
+ * Compares the fmin + pow() path the drive code used to run every tick
+ * (scale_joystick_exact below) with the program's own compile-time preset
+ * tables + interpolation (scale_joystick), and checks every preset against
+ * pow(), at the default deadzone and at a larger one from the tunables file.
+ *
+ * Build and run:
+ *   g++ -O2 -std=c++11 -Ihost host/curve_bench.cpp host/vex.cpp -o curve_bench -lpthread && ./curve_bench
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <chrono>
+
+double scale_joystick_exact(double input)
+{
+    double result;
+    if (input > deadzone) {
+        result = fmin((input - deadzone) / (1.0 - deadzone), 1.0);
+        result *= pow(result, smooth_power);
+    }
+    else {
+        return 0.;
+    }
+    return result;
+}
+
+// Inputs as arcadedrive() sees them: joystick vector length over 127, 0 to ~1.41
+const int NUM_INPUTS = 255 * 255;
+static double inputs[NUM_INPUTS];
+
+template <class F>
+double time_ns_per_call(F f, int rounds, double &sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < NUM_INPUTS; i++) sink += f(inputs[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / ((double)rounds * NUM_INPUTS);
+}
+
+int main() {
+    int n = 0;
+    for (int px = -127; px <= 127; px++) {
+        for (int py = -127; py <= 127; py++) {
+            inputs[n++] = sqrt((double)(px * px + py * py)) / JOY_SCALE;
+        }
+    }
+
+    const int ROUNDS = 20;
+    const double DEADZONES[] = {DEADZONE, 0.1};
+    double sink = 0.;
+    double worst_err = 0.;
+    printf("deadzone  smooth_power  pow ns/call  table ns/call  max abs error\n");
+    for (double dz : DEADZONES) {
+        deadzone = dz;
+        for (int p = 0; p < NUM_CURVE_PRESETS; p++) {
+            set_curve_preset(p);
+            double max_err = 0.;
+            for (int i = 0; i < NUM_INPUTS; i++) {
+                max_err = fmax(max_err, fabs(scale_joystick(inputs[i]) - scale_joystick_exact(inputs[i])));
+            }
+            worst_err = fmax(worst_err, max_err);
+            if (p % 5 != 0 && p != NUM_CURVE_PRESETS - 1) continue;  // time a few presets only
+            double t_pow = time_ns_per_call(scale_joystick_exact, ROUNDS, sink);
+            double t_table = time_ns_per_call(scale_joystick, ROUNDS, sink);
+            printf("%8.2f  %12.2f  %11.2f  %13.2f  %13.5f\n", deadzone, smooth_power, t_pow, t_table, max_err);
+        }
+    }
+    printf("worst error over all %d presets: %.5f\n", NUM_CURVE_PRESETS, worst_err);
+    printf("preset tables: %u bytes\n", (unsigned)(NUM_CURVE_PRESETS * sizeof(CurveTable)));
+    return sink == 0.;  // keep the optimizer from dropping the timed loops
+}
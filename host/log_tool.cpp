@@ -0,0 +1,555 @@
+/*
+ * Host-side decoder and analysis for the telemetry logs of "Arcade Drive
+ * final" (shs_logNN.bin from the brain's SD card, written by telemetryRecord).
+ *
+ *   log_tool [--csv] [--json] [--threads N] FILE...
+ *   log_tool check
+ *
+ * For each log prints:
+ *   period    control tick period from the record times: average, jitter
+ *             (standard deviation), worst, and how the periods spread over
+ *             PERIOD_BUCKET_US buckets
+ *   response  how fast the drive follows a step in its command: for every
+ *             change of at least RESPONSE_MIN_STEP_PCT in a side's commanded
+ *             power, the time until the measured speed has gone half way to
+ *             the commanded one (100% is DRIVE_RPM); average, worst, and steps
+ *             not answered within RESPONSE_WINDOW_US. Steps the driver changes
+ *             again before then are not counted
+ *   power     drawn by each drive side and the spinner, estimated as battery
+ *             voltage times current, average and peak
+ *   temp      hottest drive motor and the spinner, at the start and at the peak
+ *   battery   lowest voltage
+ *   stopping, spinner
+ *             share of the time in each stopping mode and spinner state
+ * along with the records lost, from gaps in the sequence numbers (a full ring
+ * on the robot, a failed write) and a cut-off record at the end. Record times
+ * are in us since version 2; version 1 logs, in whole ms, still read.
+ *
+ * --csv writes every record to FILE.csv, in units. --json writes the summary
+ * to FILE.json, with power, temperature and battery curves at one point a
+ * second. Each log is mapped into memory and decoded in a single pass, and
+ * logs are shared out over --threads workers (all cores by default), so
+ * hundreds of logs take seconds.
+ *
+ * check drives the program in the simulator with telemetry on, then reads
+ * back what it logged and checks the decoder and statistics against what was
+ * driven, and against damaged logs.
+ *
+ * The program is compiled in for the log format and the check. Build:
+ *   g++ -O2 -std=c++11 -Ihost host/log_tool.cpp host/vex.cpp -o log_tool -lpthread
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+const int RESPONSE_MIN_STEP_PCT = 20;
+const int RESPONSE_HOLD_PCT = 5;           // a command moving more than this is a new step
+const double RESPONSE_FRACTION = 0.5;
+const uint32_t RESPONSE_WINDOW_US = 300000;
+const double DRIVE_RPM = 200.;             // ratio18_1 at 100%
+const uint32_t PERIOD_BUCKET_US = 250;
+const int PERIOD_BUCKETS = 81;  // 0 to 20 ms in 0.25 ms steps, then 20 ms and over
+const uint32_t CURVE_US = 1000000;
+const uint16_t OLDEST_TELEMETRY_VERSION = 1;
+const char *const STOPPING_NAMES[3] = {"coast", "brake", "hold"};
+const char *const SPINNER_NAMES[3] = {"off", "fwd", "rev"};
+enum { LEFT, RIGHT, SPINNER };
+
+/* One record, in units */
+struct LogRecord {
+    uint32_t seq;
+    uint32_t t_us;          // wraps after 71 minutes, so only differences count
+    int axis1, axis2;
+    uint16_t buttons;
+    bool reversed;
+    int stopping_mode;
+    int spinner_state;
+    bool spinner_ready;
+    bool recording;
+    int curve_preset;
+    int left_pct, right_pct;
+    double left_rpm, right_rpm;
+    double spinner_target_rpm, spinner_rpm;
+    double amps[3];         // left, right, spinner
+    int drive_temp_c, spinner_temp_c;
+    double battery_volts, battery_amps;
+};
+
+static LogRecord decodeRecord(const uint8_t *p, int version) {
+    LogRecord r;
+    r.seq = getU32(p);
+    r.t_us = version == 1 ? getU32(p + 4) * 1000u : getU32(p + 4);
+    r.axis1 = (int8_t)p[8];
+    r.axis2 = (int8_t)p[9];
+    r.buttons = (uint16_t)getU16(p + 10);
+    r.reversed = p[12] & 1;
+    r.stopping_mode = p[12] >> 1 & 3;
+    r.spinner_state = p[12] >> 3 & 3;
+    r.spinner_ready = p[12] >> 5 & 1;
+    r.recording = p[12] >> 6 & 1;
+    r.curve_preset = p[13];
+    r.left_pct = (int8_t)p[14];
+    r.right_pct = (int8_t)p[15];
+    r.left_rpm = (int16_t)getU16(p + 16) / 10.;
+    r.right_rpm = (int16_t)getU16(p + 18) / 10.;
+    r.spinner_target_rpm = (int16_t)getU16(p + 20);
+    r.spinner_rpm = (int16_t)getU16(p + 22);
+    for (int i = 0; i < 3; i++) r.amps[i] = p[24 + i] * 0.02;
+    r.drive_temp_c = p[27];
+    r.spinner_temp_c = p[28];
+    r.battery_volts = getU16(p + 29) / 1000.;
+    r.battery_amps = p[31] * 0.1;
+    return r;
+}
+
+struct CurvePoint {
+    uint32_t second;            // since the first record; seconds with nothing logged are left out
+    double power_sum[3];
+    long n;
+    int drive_temp_c, spinner_temp_c;
+    double battery_min;
+};
+
+struct LogSummary {
+    std::string error;          // why the log could not be read; empty if it could
+    int version;
+    int period_ms;              // from the header
+    long records;
+    long lost;                  // records missing from the sequence
+    long trailing_bytes;        // a cut-off record at the end
+    uint64_t span_us;           // first record to last
+    long periods;
+    double period_sum, period_sq;  // us
+    uint32_t period_max;
+    long period_hist[PERIOD_BUCKETS];
+    long responses;
+    double response_sum;
+    uint32_t response_max;      // us
+    long response_missed;
+    double power_sum[3], power_peak[3];
+    int temp_start[2], temp_peak[2];  // drive, spinner
+    double battery_min;
+    long in_stopping[3];
+    long in_spinner[3];
+    std::vector<CurvePoint> curve;
+};
+
+// Decode and summarize len bytes of log; writes every record to csv if not null
+static void analyze(const uint8_t *data, size_t len, FILE *csv, LogSummary &s) {
+    s = LogSummary();
+    if (len < (size_t)TELEMETRY_HEADER_BYTES || memcmp(data, TELEMETRY_MAGIC, 4) != 0) {
+        s.error = "not a telemetry log";
+        return;
+    }
+    s.version = getU16(data + 4);
+    if (s.version < OLDEST_TELEMETRY_VERSION || s.version > TELEMETRY_VERSION ||
+        getU16(data + 6) != TELEMETRY_RECORD_BYTES) {
+        s.error = "log version " + std::to_string(s.version) + ", this tool reads versions " +
+                  std::to_string(OLDEST_TELEMETRY_VERSION) + " to " + std::to_string(TELEMETRY_VERSION);
+        return;
+    }
+    s.period_ms = getU16(data + 8);
+    size_t body = len - TELEMETRY_HEADER_BYTES;
+    s.records = (long)(body / TELEMETRY_RECORD_BYTES);
+    s.trailing_bytes = (long)(body % TELEMETRY_RECORD_BYTES);
+    s.battery_min = INFINITY;
+    if (csv) {
+        fprintf(csv, "seq,t_us,axis1,axis2,buttons,reversed,stopping_mode,spinner_state,spinner_ready,recording,"
+                     "curve_preset,left_pct,right_pct,left_rpm,right_rpm,spinner_target_rpm,spinner_rpm,"
+                     "left_amps,right_amps,spinner_amps,drive_temp_c,spinner_temp_c,battery_volts,battery_amps\n");
+    }
+
+    LogRecord prev = LogRecord();
+    struct Step {
+        bool pending;           // waiting for the speed to follow
+        uint32_t start_us;
+        int pct;
+        double from_rpm, to_rpm;
+    } steps[2] = {};
+    for (long i = 0; i < s.records; i++) {
+        LogRecord r = decodeRecord(data + TELEMETRY_HEADER_BYTES + i * TELEMETRY_RECORD_BYTES, s.version);
+        if (csv) {
+            fprintf(csv, "%u,%u,%d,%d,%u,%d,%d,%d,%d,%d,%d,%d,%d,%.1f,%.1f,%.0f,%.0f,%.2f,%.2f,%.2f,%d,%d,%.3f,%.1f\n",
+                    r.seq, r.t_us, r.axis1, r.axis2, r.buttons, r.reversed, r.stopping_mode, r.spinner_state,
+                    r.spinner_ready, r.recording, r.curve_preset, r.left_pct, r.right_pct, r.left_rpm, r.right_rpm,
+                    r.spinner_target_rpm, r.spinner_rpm, r.amps[LEFT], r.amps[RIGHT], r.amps[SPINNER],
+                    r.drive_temp_c, r.spinner_temp_c, r.battery_volts, r.battery_amps);
+        }
+
+        bool follows = i > 0 && r.seq == prev.seq + 1;
+        if (i == 0) {
+            s.temp_start[0] = s.temp_peak[0] = r.drive_temp_c;
+            s.temp_start[1] = s.temp_peak[1] = r.spinner_temp_c;
+        } else {
+            if (r.seq > prev.seq) s.lost += r.seq - prev.seq - 1;
+            s.span_us += r.t_us - prev.t_us;
+        }
+
+        // Tick periods, between records with nothing lost in between
+        if (follows) {
+            uint32_t period = r.t_us - prev.t_us;
+            s.periods++;
+            s.period_sum += period;
+            s.period_sq += (double)period * period;
+            s.period_max = std::max(s.period_max, period);
+            s.period_hist[std::min(period / PERIOD_BUCKET_US, (uint32_t)PERIOD_BUCKETS - 1)]++;
+        }
+
+        // Command to measured speed response, per side. The speed in a record is
+        // read in the same tick as the command is sent, so before the motor reacts.
+        for (int side = LEFT; side <= RIGHT; side++) {
+            Step &st = steps[side];
+            int pct = side == LEFT ? r.left_pct : r.right_pct;
+            int prev_pct = side == LEFT ? prev.left_pct : prev.right_pct;
+            double rpm = side == LEFT ? r.left_rpm : r.right_rpm;
+            if (!follows || (st.pending && abs(pct - st.pct) > RESPONSE_HOLD_PCT)) st.pending = false;
+            if (follows && abs(pct - prev_pct) >= RESPONSE_MIN_STEP_PCT &&
+                fabs(pct * DRIVE_RPM / 100. - rpm) >= RESPONSE_MIN_STEP_PCT * DRIVE_RPM / 100.) {
+                st = {true, r.t_us, pct, rpm, pct * DRIVE_RPM / 100.};
+                continue;
+            }
+            if (!st.pending) continue;
+            uint32_t elapsed = r.t_us - st.start_us;
+            if ((rpm - st.from_rpm) / (st.to_rpm - st.from_rpm) >= RESPONSE_FRACTION) {
+                s.responses++;
+                s.response_sum += elapsed;
+                s.response_max = std::max(s.response_max, elapsed);
+                st.pending = false;
+            } else if (elapsed > RESPONSE_WINDOW_US) {
+                s.response_missed++;
+                st.pending = false;
+            }
+        }
+
+        // Power, temperature, battery, and their curves
+        uint32_t second = (uint32_t)(s.span_us / CURVE_US);
+        if (s.curve.empty() || s.curve.back().second != second) {
+            CurvePoint c = {second, {0., 0., 0.}, 0, 0, 0, INFINITY};
+            s.curve.push_back(c);
+        }
+        CurvePoint &c = s.curve.back();
+        for (int m = 0; m < 3; m++) {
+            double watts = r.battery_volts * r.amps[m];
+            s.power_sum[m] += watts;
+            s.power_peak[m] = fmax(s.power_peak[m], watts);
+            c.power_sum[m] += watts;
+        }
+        c.n++;
+        c.drive_temp_c = std::max(c.drive_temp_c, r.drive_temp_c);
+        c.spinner_temp_c = std::max(c.spinner_temp_c, r.spinner_temp_c);
+        c.battery_min = fmin(c.battery_min, r.battery_volts);
+        s.temp_peak[0] = std::max(s.temp_peak[0], r.drive_temp_c);
+        s.temp_peak[1] = std::max(s.temp_peak[1], r.spinner_temp_c);
+        s.battery_min = fmin(s.battery_min, r.battery_volts);
+
+        // Modes; spinner states 0 and 2 are both stopped
+        s.in_stopping[std::min(r.stopping_mode, 2)]++;
+        s.in_spinner[r.spinner_state % 2 == 0 ? 0 : (r.spinner_state == 1 ? 1 : 2)]++;
+        prev = r;
+    }
+    if (s.trailing_bytes) s.lost++;
+}
+
+static double share(long n, long total) { return total ? 100. * n / total : 0.; }
+
+static std::string textSummary(const char *name, const LogSummary &s) {
+    char buf[2048];
+    std::string out;
+    if (!s.error.empty()) return std::string(name) + ": " + s.error + "\n";
+    snprintf(buf, sizeof(buf), "%s: %ld records, %.1f s, %ld lost\n", name, s.records,
+             s.span_us / 1e6, s.lost);
+    out += buf;
+    if (s.records == 0) return out;
+    double mean = s.periods ? s.period_sum / s.periods : 0.;
+    double jitter = s.periods ? sqrt(fmax(0., s.period_sq / s.periods - mean * mean)) : 0.;
+    snprintf(buf, sizeof(buf), "  period    %.3f ms average (%d ms wanted), jitter %.3f ms, worst %.3f ms;",
+             mean / 1000., s.period_ms, jitter / 1000., s.period_max / 1000.);
+    out += buf;
+    for (int b = 0; b < PERIOD_BUCKETS; b++) {
+        if (!s.period_hist[b]) continue;
+        snprintf(buf, sizeof(buf), " %s%.2f ms %.1f%%", b == PERIOD_BUCKETS - 1 ? ">=" : "",
+                 b * PERIOD_BUCKET_US / 1000., share(s.period_hist[b], s.periods));
+        out += buf;
+    }
+    snprintf(buf, sizeof(buf), "\n  response  %ld command steps, half way in %.1f ms average, %.1f ms worst; "
+                               "%ld not within %u ms\n", s.responses,
+             s.responses ? s.response_sum / s.responses / 1000. : 0., s.response_max / 1000., s.response_missed,
+             RESPONSE_WINDOW_US / 1000);
+    out += buf;
+    snprintf(buf, sizeof(buf), "  power     left %.1f W average, %.1f W peak; right %.1f W, %.1f W; spinner %.1f W, %.1f W\n",
+             s.power_sum[LEFT] / s.records, s.power_peak[LEFT], s.power_sum[RIGHT] / s.records, s.power_peak[RIGHT],
+             s.power_sum[SPINNER] / s.records, s.power_peak[SPINNER]);
+    out += buf;
+    snprintf(buf, sizeof(buf), "  temp      drive %d C at the start, %d C peak; spinner %d C, %d C\n", s.temp_start[0],
+             s.temp_peak[0], s.temp_start[1], s.temp_peak[1]);
+    out += buf;
+    snprintf(buf, sizeof(buf), "  battery   lowest %.2f V\n", s.battery_min);
+    out += buf;
+    out += "  stopping ";
+    for (int m = 0; m < 3; m++) {
+        snprintf(buf, sizeof(buf), " %s %.1f%%", STOPPING_NAMES[m], share(s.in_stopping[m], s.records));
+        out += buf;
+    }
+    out += "\n  spinner  ";
+    for (int m = 0; m < 3; m++) {
+        snprintf(buf, sizeof(buf), " %s %.1f%%", SPINNER_NAMES[m], share(s.in_spinner[m], s.records));
+        out += buf;
+    }
+    return out + "\n";
+}
+
+static bool writeJson(const char *path, const LogSummary &s) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    double mean = s.periods ? s.period_sum / s.periods : 0.;
+    fprintf(f, "{\n  \"records\": %ld,\n  \"lost\": %ld,\n  \"duration_s\": %.6f,\n", s.records, s.lost,
+            s.span_us / 1e6);
+    fprintf(f, "  \"period_ms\": {\"wanted\": %d, \"average\": %.3f, \"jitter\": %.3f, \"worst\": %.3f, "
+               "\"bucket_ms\": %.3f, \"histogram\": [",
+            s.period_ms, mean / 1000., s.periods ? sqrt(fmax(0., s.period_sq / s.periods - mean * mean)) / 1000. : 0.,
+            s.period_max / 1000., PERIOD_BUCKET_US / 1000.);
+    for (int b = 0; b < PERIOD_BUCKETS; b++) fprintf(f, "%s%ld", b ? ", " : "", s.period_hist[b]);
+    fprintf(f, "]},\n  \"response_ms\": {\"steps\": %ld, \"average\": %.3f, \"worst\": %.3f, \"missed\": %ld},\n",
+            s.responses, s.responses ? s.response_sum / s.responses / 1000. : 0., s.response_max / 1000.,
+            s.response_missed);
+    fprintf(f, "  \"power_w\": {");
+    const char *parts[3] = {"left", "right", "spinner"};
+    for (int m = 0; m < 3; m++) {
+        fprintf(f, "%s\"%s\": {\"average\": %.2f, \"peak\": %.2f}", m ? ", " : "", parts[m],
+                s.records ? s.power_sum[m] / s.records : 0., s.power_peak[m]);
+    }
+    fprintf(f, "},\n  \"temp_c\": {\"drive\": {\"start\": %d, \"peak\": %d}, \"spinner\": {\"start\": %d, \"peak\": %d}},\n",
+            s.temp_start[0], s.temp_peak[0], s.temp_start[1], s.temp_peak[1]);
+    fprintf(f, "  \"battery_min_v\": %.3f,\n  \"stopping_share\": {", s.records ? s.battery_min : 0.);
+    for (int m = 0; m < 3; m++) fprintf(f, "%s\"%s\": %.4f", m ? ", " : "", STOPPING_NAMES[m], share(s.in_stopping[m], s.records) / 100.);
+    fprintf(f, "},\n  \"spinner_share\": {");
+    for (int m = 0; m < 3; m++) fprintf(f, "%s\"%s\": %.4f", m ? ", " : "", SPINNER_NAMES[m], share(s.in_spinner[m], s.records) / 100.);
+    fprintf(f, "},\n  \"curve\": [");
+    for (size_t i = 0; i < s.curve.size(); i++) {
+        const CurvePoint &c = s.curve[i];
+        fprintf(f, "%s\n    {\"t_s\": %u, \"left_w\": %.2f, \"right_w\": %.2f, \"spinner_w\": %.2f, "
+                   "\"drive_temp_c\": %d, \"spinner_temp_c\": %d, \"battery_min_v\": %.3f}",
+                i ? "," : "", c.second, c.power_sum[LEFT] / c.n, c.power_sum[RIGHT] / c.n,
+                c.power_sum[SPINNER] / c.n, c.drive_temp_c, c.spinner_temp_c, c.battery_min);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+// Map a log into memory and analyze it, writing FILE.csv and FILE.json if asked
+static void processFile(const std::string &path, bool csv, bool json, LogSummary &s) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        s = LogSummary();
+        s.error = "cannot open";
+        if (fd >= 0) close(fd);
+        return;
+    }
+    size_t len = (size_t)st.st_size;
+    const uint8_t *data = nullptr;
+    if (len > 0) {
+        void *m = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            data = (const uint8_t *)m;
+            madvise(m, len, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    static const uint8_t nothing[1] = {0};
+    FILE *out = nullptr;
+    if (csv) {
+        out = fopen((path + ".csv").c_str(), "w");
+        if (out) setvbuf(out, nullptr, _IOFBF, 1 << 16);
+    }
+    analyze(data ? data : nothing, data ? len : 0, out, s);
+    if (out && fclose(out) != 0 && s.error.empty()) s.error = "cannot write " + path + ".csv";
+    if (json && s.error.empty() && !writeJson((path + ".json").c_str(), s)) s.error = "cannot write " + path + ".json";
+    if (data) munmap((void *)data, len);
+}
+
+/* check: log the program's own driving in the simulator, then read it back */
+
+static bool check_ok = true;
+
+static void expect(bool cond, const char *what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        check_ok = false;
+    }
+}
+
+static std::vector<uint8_t> readAll(const std::string &path) {
+    std::vector<uint8_t> buf;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return buf;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) buf.insert(buf.end(), chunk, chunk + n);
+    fclose(f);
+    return buf;
+}
+
+static int check() {
+    char dir[] = "/tmp/log_checkXXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("cannot make a directory for the SD card\n");
+        return 1;
+    }
+    sim::sdcard_dir = dir;
+    pre_auton();  // starts logging
+    std::string path = std::string(dir) + "/" + telemetry_file;
+    expect(telemetry_file[0] != 0, "telemetry starts with a card in");
+
+    // 20 s of driving: sticks moved every 400 ms, brake from 5 s, spinner forward from 10 s to 15 s
+    const int TICKS = 20000 / DRIVE_PERIOD_MS;
+    std::vector<int> stopping(TICKS), spinner(TICKS);
+    for (int i = 0; i < TICKS; i++) {
+        int t = i * DRIVE_PERIOD_MS;
+        if (t % 400 == 0) {
+            Controller1.Axis1.val = (t / 400 % 5) * 20 - 40;
+            Controller1.Axis2.val = (t / 400 % 3) * 60 - 60;
+        }
+        if (t == 5000) stopping_mode_toggle();
+        if (t == 10000 || t == 15000) spinner_toggle();
+        driver_tick();
+        stopping[i] = stopping_mode_num;
+        spinner[i] = spinner_state % 2 == 0 ? 0 : (spinner_state == 1 ? 1 : 2);
+        task::sleep(DRIVE_PERIOD_MS);
+    }
+    task::sleep(2 * TELEMETRY_FLUSH_MS);
+
+    LogSummary s;
+    processFile(path, true, true, s);
+    long written = (long)telemetry_flushed.load() * TELEMETRY_BLOCK_RECORDS;
+    expect(s.error.empty(), "the log reads");
+    expect(s.records == written && s.lost == 0, "every full block is in the log, nothing lost");
+    expect(s.period_ms == DRIVE_PERIOD_MS && s.period_max == DRIVE_PERIOD_MS * 1000u &&
+           s.period_hist[DRIVE_PERIOD_MS * 1000 / PERIOD_BUCKET_US] == s.records - 1, "periods are the drive period");
+    expect(s.responses > 0 && s.response_missed == 0 && s.response_max > DRIVE_PERIOD_MS * 1000u &&
+           s.response_max < RESPONSE_WINDOW_US, "the drive follows its command steps");
+    long in_stopping[3] = {0, 0, 0}, in_spinner[3] = {0, 0, 0};
+    for (long i = 0; i < s.records; i++) {
+        in_stopping[stopping[i]]++;
+        in_spinner[spinner[i]]++;
+    }
+    expect(memcmp(in_stopping, s.in_stopping, sizeof(in_stopping)) == 0 &&
+           memcmp(in_spinner, s.in_spinner, sizeof(in_spinner)) == 0, "time in each mode matches the driving");
+    expect(s.power_peak[SPINNER] > 0. && s.power_peak[LEFT] > 0., "power is drawn");
+    expect(s.battery_min > 10. && s.battery_min < sim::BATTERY_VOLTS, "battery sags under load");
+    expect(s.curve.size() == (size_t)ceil(s.records * DRIVE_PERIOD_MS * 1000. / CURVE_US), "a curve point a second");
+    std::vector<uint8_t> text = readAll(path + ".csv");
+    expect(std::count(text.begin(), text.end(), '\n') == s.records + 1, "a CSV line per record");
+    expect(!readAll(path + ".json").empty(), "JSON summary written");
+
+    // Damaged logs
+    std::vector<uint8_t> good = readAll(path), bad;
+    LogSummary d;
+    bad = good;
+    bad[0] = 'X';
+    analyze(bad.data(), bad.size(), nullptr, d);
+    expect(!d.error.empty(), "other files are refused");
+    bad = good;
+    putU16(bad.data() + 4, TELEMETRY_VERSION + 1);
+    analyze(bad.data(), bad.size(), nullptr, d);
+    expect(!d.error.empty(), "other versions are refused");
+    analyze(good.data(), 3, nullptr, d);
+    expect(!d.error.empty(), "a cut-off header is refused");
+    bad = good;
+    putU16(bad.data() + 4, 1);
+    for (size_t at = TELEMETRY_HEADER_BYTES + 4; at + 4 <= bad.size(); at += TELEMETRY_RECORD_BYTES) {
+        putU32(bad.data() + at, getU32(bad.data() + at) / 1000);
+    }
+    analyze(bad.data(), bad.size(), nullptr, d);
+    expect(d.error.empty() && d.periods == s.periods && d.period_max == s.period_max && d.span_us == s.span_us,
+           "version 1 logs, in ms, still read");
+    bad = good;
+    size_t gap = TELEMETRY_HEADER_BYTES + 100 * TELEMETRY_RECORD_BYTES;
+    bad.erase(bad.begin() + gap, bad.begin() + gap + 10 * TELEMETRY_RECORD_BYTES);
+    analyze(bad.data(), bad.size() - 7, nullptr, d);
+    expect(d.error.empty() && d.lost == 11 && d.records == s.records - 11 && d.trailing_bytes == TELEMETRY_RECORD_BYTES - 7 &&
+           d.periods == s.periods - 12, "gaps and a cut-off last record are counted as lost");
+
+    // Made up: both sides step to 100%, the left gains 20 rpm a tick and the right never moves
+    std::vector<uint8_t> made(TELEMETRY_HEADER_BYTES + 100 * TELEMETRY_RECORD_BYTES, 0);
+    memcpy(made.data(), good.data(), TELEMETRY_HEADER_BYTES);
+    for (int i = 0; i < 100; i++) {
+        uint8_t *p = made.data() + TELEMETRY_HEADER_BYTES + i * TELEMETRY_RECORD_BYTES;
+        putU32(p, i);
+        putU32(p + 4, i * DRIVE_PERIOD_MS * 1000);
+        p[14] = p[15] = i >= 10 ? 100 : 0;
+        putU16(p + 16, (uint16_t)(i >= 10 ? std::min(i - 10, 10) * 200 : 0));  // 0.1 rpm
+    }
+    analyze(made.data(), made.size(), nullptr, d);
+    expect(d.responses == 1 && d.response_max == 5u * DRIVE_PERIOD_MS * 1000 && d.response_missed == 1,
+           "half way to the commanded speed after 5 ticks, and a side that never follows");
+
+    remove((path + ".csv").c_str());
+    remove((path + ".json").c_str());
+    remove(path.c_str());
+    rmdir(dir);
+    printf(check_ok ? "OK\n" : "FAILED\n");
+    return check_ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && std::string(argv[1]) == "check") return check();
+    bool csv = false, json = false;
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--csv") csv = true;
+        else if (a == "--json") json = true;
+        else if (a == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (a.compare(0, 2, "--") != 0) files.push_back(a);
+        else {
+            files.clear();
+            break;
+        }
+    }
+    if (files.empty()) {
+        printf("usage: %s [--csv] [--json] [--threads N] FILE... | check\n", argv[0]);
+        return 2;
+    }
+    threads = std::max(1, std::min(threads, (int)files.size()));
+
+    // Workers take the next file until none are left; reports print in order
+    std::vector<LogSummary> summaries(files.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; w++) {
+        pool.push_back(std::thread([&] {
+            for (size_t i; (i = next++) < files.size();) processFile(files[i], csv, json, summaries[i]);
+        }));
+    }
+    for (std::thread &t : pool) t.join();
+
+    long records = 0, lost = 0, failed = 0;
+    double seconds = 0.;
+    for (size_t i = 0; i < files.size(); i++) {
+        fputs(textSummary(files[i].c_str(), summaries[i]).c_str(), stdout);
+        if (!summaries[i].error.empty()) {
+            failed++;
+            continue;
+        }
+        records += summaries[i].records;
+        lost += summaries[i].lost;
+        seconds += summaries[i].span_us / 1e6;
+    }
+    if (files.size() > 1) {
+        printf("%zu logs, %ld records, %.1f s, %ld lost, %ld unreadable\n", files.size(), records, seconds, lost, failed);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Host-side round-trip check for the recorded routine format in
+ * "Arcade Drive final" (routineWrite / routineNext).
+ *
+ * Encodes generated driving traces - held sticks, sudden full-range jumps,
+ * timing jitter, button presses and runs long enough to split a button run -
+ * decodes them again and checks every sample against the input (wheel
+ * distances to the millimeter the format stores). Also decodes every
+ * truncation of a routine to check the reader stops cleanly, and reports the
+ * encoded size per sample. Then saves a recording to the SD card the way the
+ * robot does (saveRecordingIfDue) and loads it back (loadRecording), through
+ * host/vex.h's SD card in a temporary directory, and checks that damaged files
+ * are refused.
+ *
+ * The program is compiled in, so this checks the robot's own code. Build and run:
+ *   g++ -std=c++11 -Ihost host/routine_check.cpp host/vex.cpp -o routine_check -lpthread
+ *   ./routine_check
+ * Add -fsanitize=address to catch reads past the end of a routine.
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <unistd.h>
+#include <vector>
+
+static uint32_t rng_state = 12345;
+
+// Small fixed-seed generator, so failures repeat
+static uint32_t rnd(uint32_t n) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (rng_state >> 8) % n;
+}
+
+enum TraceKind { TRACE_DRIVING, TRACE_RANDOM, TRACE_LONG_HOLD };
+
+// Generate a trace of n samples
+static std::vector<DriverSample> makeTrace(TraceKind kind, int n) {
+    std::vector<DriverSample> trace(n);
+    DriverSample s = {0, 0, 0, 0, 0.f, 0.f};
+    double v_left = 0., v_right = 0.;
+    for (int i = 0; i < n; i++) {
+        switch (kind) {
+            case TRACE_DRIVING:
+                // sticks held for a while, then moved; a button pressed now and then
+                s.t_ms += DRIVE_PERIOD_MS + (rnd(20) == 0 ? rnd(3) : 0);
+                if (rnd(40) == 0) s.axis1 = (int8_t)((int)rnd(255) - 127);
+                if (rnd(40) == 0) s.axis2 = (int8_t)((int)rnd(255) - 127);
+                if (rnd(10) == 0) s.axis1 = (int8_t)fmax(-127, fmin(127, s.axis1 + (int)rnd(5) - 2));
+                s.buttons = rnd(200) == 0 ? (uint16_t)(1 << rnd(NUM_BUTTON_BINDINGS)) : (rnd(4) ? s.buttons : 0);
+                v_left += ((s.axis2 + s.axis1) / 127. * 1.3 - v_left) * 0.08;
+                v_right += ((s.axis2 - s.axis1) / 127. * 1.3 - v_right) * 0.08;
+                s.left += (float)(v_left * DRIVE_PERIOD_MS / 1000.);
+                s.right += (float)(v_right * DRIVE_PERIOD_MS / 1000.);
+                break;
+            case TRACE_RANDOM:
+                // worst case: everything changes every sample
+                s.t_ms += rnd(1000);
+                s.axis1 = (int8_t)((int)rnd(255) - 127);
+                s.axis2 = (int8_t)((int)rnd(255) - 127);
+                s.buttons = (uint16_t)rnd(1 << NUM_BUTTON_BINDINGS);
+                s.left += (float)((int)rnd(200001) - 100000) / 1000.f;
+                s.right += (float)((int)rnd(200001) - 100000) / 1000.f;
+                break;
+            case TRACE_LONG_HOLD:
+                // nothing moves, one button held past the u16 run length
+                s.t_ms += DRIVE_PERIOD_MS;
+                s.buttons = 1;
+                break;
+        }
+        trace[i] = s;
+    }
+    return trace;
+}
+
+static bool same(const DriverSample &a, const DriverSample &b) {
+    return a.t_ms == b.t_ms && a.axis1 == b.axis1 && a.axis2 == b.axis2 && a.buttons == b.buttons &&
+           lround(a.left * 1000.) == lround(b.left * 1000.) && lround(a.right * 1000.) == lround(b.right * 1000.);
+}
+
+// Encode and decode a trace; returns the encoded length, or -1 on a mismatch
+static int roundTrip(const char *name, const std::vector<DriverSample> &trace, std::vector<uint8_t> &buf) {
+    RoutineHeader hdr = {DRIVE_ARCADE, DRIVE_PERIOD_MS, {31, true, 2, 1, 525.}, 0};
+    RoutineWriter w;
+    routineWriterInit(w, buf.data(), (int)buf.size(), hdr);
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (!routineWrite(w, trace[i])) {
+            printf("%s: buffer full at sample %zu\n", name, i);
+            return -1;
+        }
+    }
+
+    RoutineHeader got;
+    RoutineReader rd;
+    if (!routineReaderInit(rd, buf.data(), w.len, got) || got.sample_count != trace.size() ||
+        got.drive_mode != hdr.drive_mode || got.period_ms != hdr.period_ms ||
+        got.settings.curve_preset != 31 || !got.settings.reversed || got.settings.stopping_mode_num != 2 ||
+        got.settings.spinner_state != 1 || got.settings.spinner_rpm != 525.) {
+        printf("%s: header mismatch\n", name);
+        return -1;
+    }
+    DriverSample s;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (!routineNext(rd, s) || !same(s, trace[i])) {
+            printf("%s: sample %zu differs\n", name, i);
+            return -1;
+        }
+    }
+    if (routineNext(rd, s) || rd.pos != w.len) {
+        printf("%s: data after the last sample\n", name);
+        return -1;
+    }
+    printf("%-12s %6zu samples %7d bytes  %.2f bytes/sample\n", name, trace.size(), w.len,
+           (double)(w.len - ROUTINE_HEADER_BYTES) / trace.size());
+    return w.len;
+}
+
+// Every prefix of a routine must decode to a prefix of its samples and then stop
+static bool checkTruncation(const std::vector<DriverSample> &trace, const std::vector<uint8_t> &buf, int len) {
+    for (int cut = 0; cut < len; cut++) {
+        std::vector<uint8_t> part(buf.begin(), buf.begin() + cut);  // exact size, for the sanitizer
+        RoutineHeader hdr;
+        RoutineReader rd;
+        if (!routineReaderInit(rd, part.data(), cut, hdr)) {
+            if (cut >= ROUTINE_HEADER_BYTES) {
+                printf("truncation: header rejected at %d bytes\n", cut);
+                return false;
+            }
+            continue;
+        }
+        DriverSample s;
+        size_t i = 0;
+        while (routineNext(rd, s)) {
+            if (i >= trace.size() || !same(s, trace[i])) {
+                printf("truncation: wrong sample %zu at %d bytes\n", i, cut);
+                return false;
+            }
+            i++;
+        }
+    }
+    return true;
+}
+
+// Decode the routine auton state 6 would play and compare it with the trace
+static bool sameAsLoaded(const std::vector<DriverSample> &trace) {
+    RoutineHeader hdr;
+    RoutineReader rd;
+    if (!routineReaderInit(rd, routine_buf, routine_writer.len, hdr) || hdr.sample_count != trace.size()) return false;
+    DriverSample s;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (!routineNext(rd, s) || !same(s, trace[i])) return false;
+    }
+    return true;
+}
+
+static bool loadsNothing() {
+    memset(&routine_writer, 0, sizeof(routine_writer));
+    return !loadRecording() && routine_writer.len == 0;
+}
+
+// Save a recording, load it back, and make sure damaged files are refused
+static bool checkFile(const std::vector<DriverSample> &trace) {
+    char dir[] = "/tmp/routine_checkXXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("file: cannot make a directory for the SD card\n");
+        return false;
+    }
+    sim::sdcard_dir = dir;
+    char path[sizeof(dir) + sizeof(ROUTINE_FILE)];
+    snprintf(path, sizeof(path), "%s/%s", dir, ROUTINE_FILE);
+    bool ok = true;
+
+    RoutineHeader hdr = {DRIVE_ARCADE, DRIVE_PERIOD_MS, currentDriveSettings(), 0};
+    routineWriterInit(routine_writer, routine_buf, ROUTINE_BUF_BYTES, hdr);
+    for (size_t i = 0; i < trace.size(); i++) routineWrite(routine_writer, trace[i]);
+    int len = routine_writer.len;
+    recording_on = true;
+    record_toggle();  // stop, as the driver would
+    if (!saveRecordingIfDue()) {
+        printf("file: save failed\n");
+        ok = false;
+    }
+    memset(routine_buf, 0, sizeof(routine_buf));
+    memset(&routine_writer, 0, sizeof(routine_writer));
+    if (!loadRecording() || routine_writer.len != len || !sameAsLoaded(trace)) {
+        printf("file: the saved recording does not load back the same\n");
+        ok = false;
+    }
+
+    // damaged files, and no card at all
+    std::vector<uint8_t> saved(routine_buf, routine_buf + len);
+    saved[0] ^= 0xff;
+    Brain.SDcard.savefile(ROUTINE_FILE, saved.data(), len);
+    if (!loadsNothing()) {
+        printf("file: a file with a bad magic was loaded\n");
+        ok = false;
+    }
+    saved[0] ^= 0xff;
+    Brain.SDcard.savefile(ROUTINE_FILE, saved.data(), ROUTINE_HEADER_BYTES - 1);
+    if (!loadsNothing()) {
+        printf("file: a file shorter than the header was loaded\n");
+        ok = false;
+    }
+    remove(path);
+    if (!loadsNothing()) {
+        printf("file: loaded a missing file\n");
+        ok = false;
+    }
+    sim::sdcard_dir = nullptr;
+    if (!loadsNothing()) {
+        printf("file: loaded without a card\n");
+        ok = false;
+    }
+    rmdir(dir);
+    if (ok) printf("%-12s %6zu samples %7d bytes  saved and loaded\n", "file", trace.size(), len);
+    return ok;
+}
+
+int main() {
+    std::vector<uint8_t> buf(4 << 20);
+    bool ok = true;
+
+    // A full skills run of driving must fit the robot's buffer
+    std::vector<DriverSample> driving = makeTrace(TRACE_DRIVING, MAX_RECORD_MS / DRIVE_PERIOD_MS);
+    int len = roundTrip("driving", driving, buf);
+    ok = ok && len > 0;
+    if (len > ROUTINE_BUF_BYTES) {
+        printf("driving: %d bytes does not fit ROUTINE_BUF_BYTES (%d)\n", len, ROUTINE_BUF_BYTES);
+        ok = false;
+    }
+    ok = ok && roundTrip("random", makeTrace(TRACE_RANDOM, 20000), buf) > 0;
+    ok = ok && roundTrip("long hold", makeTrace(TRACE_LONG_HOLD, 150000), buf) > 0;
+
+    std::vector<DriverSample> shortTrace = makeTrace(TRACE_RANDOM, 200);
+    len = roundTrip("truncated", shortTrace, buf);
+    ok = ok && len > 0 && checkTruncation(shortTrace, buf, len);
+    ok = checkFile(driving) && ok;
+
+    printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*
+ * Host-side bench for the controller screen layer and UI task in "Arcade
+ * Drive final" (controllerPrint / ui_loop).
+ *
+ * Runs driver control (driver_tick) for a while with moving sticks and the
+ * odd button press and reports:
+ *   changes    how often each line's text changed, as the UI task draws it
+ *   before     what the old code sent: the joystick line every tick, the
+ *              motor line whenever the motor power changed, the spinner line
+ *              on every change
+ *   sent       writes and bytes that went to the controller, and the link
+ *              use by the layer's own estimate against its budget
+ *   stale      how long a line showed something other than the newest text,
+ *              worst and average
+ *   tick       wall-clock time of a control tick, average and worst, as it
+ *              is and with the screen work done inline as before the UI task
+ *              (on the host screen writes are only memory copies, so the
+ *              difference on the robot is larger; the brain screen shows the
+ *              robot's own numbers)
+ * and checks that the screen ends up showing exactly what the program wants.
+ *
+ * Build and run:
+ *   g++ -std=c++11 -Ihost host/screen_bench.cpp host/vex.cpp -o screen_bench -lpthread
+ *   ./screen_bench [seconds (60)]
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <chrono>
+
+static uint32_t rng_state = 12345;
+
+// Small fixed-seed generator, so runs repeat
+static uint32_t rnd(uint32_t n) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (rng_state >> 8) % n;
+}
+
+static bool rowShown(int row) {
+    return memcmp(Controller1.Screen.text[row], screen_wanted[row], SCREEN_COLS) == 0;
+}
+
+struct TickTime {
+    double total_us;
+    double max_us;
+    long ticks;
+};
+
+// Set the sticks and maybe press a button, as a driver would
+static void driverInput() {
+    static void (*const buttons[])(void) = {spinner_toggle, spinner_rpm_up, spinner_rpm_down, smooth_power_up,
+                                            smooth_power_down, stopping_mode_toggle, reverse_toggle};
+    const int NUM_BUTTONS = sizeof(buttons) / sizeof(buttons[0]);
+    int &px = Controller1.Axis1.val, &py = Controller1.Axis2.val;
+    // sticks held for a while, then moved; a button now and then
+    if (rnd(40) == 0) px = (int)rnd(255) - 127;
+    if (rnd(40) == 0) py = (int)rnd(255) - 127;
+    if (rnd(10) == 0) px = (int)fmax(-127, fmin(127, px + (int)rnd(5) - 2));
+    if (rnd(400) == 0) buttons[rnd(NUM_BUTTONS)]();
+}
+
+// Time one control tick; inline_screen also does the screen work, as the loop used to
+static void timedTick(bool inline_screen, TickTime &tt) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    driver_tick();
+    if (inline_screen) {
+        renderControllerLines(ui_state.read());
+        controllerScreenRefill();
+        controllerScreenFlush();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    tt.total_us += us;
+    tt.max_us = fmax(tt.max_us, us);
+    tt.ticks++;
+}
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 60;
+    pre_auton();  // starts the UI task
+    task::sleep(1000);
+    long writes0 = Controller1.Screen.writes, bytes0 = Controller1.Screen.bytes;
+
+    TickTime now = {0., 0., 0}, before = {0., 0., 0};
+    char last[SCREEN_ROWS][SCREEN_COLS];
+    memcpy(last, screen_wanted, sizeof(last));
+    long changes[SCREEN_ROWS] = {0, 0, 0};
+    double stale_since[SCREEN_ROWS] = {-1, -1, -1};
+    double stale_max = 0., stale_total = 0.;
+    long stale_count = 0;
+    long power_changes = 0;
+    long ticks = (long)seconds * 1000 / DRIVE_PERIOD_MS;
+
+    for (long tick = 0; tick < ticks; tick++) {
+        driverInput();
+        double lp = cur_lp, rp = cur_rp;
+        timedTick(false, now);
+        if (cur_lp != lp || cur_rp != rp) power_changes++;
+        task::sleep(DRIVE_PERIOD_MS);
+
+        for (int r = 0; r < SCREEN_ROWS; r++) {
+            if (memcmp(last[r], screen_wanted[r], SCREEN_COLS) != 0) {
+                changes[r]++;
+                memcpy(last[r], screen_wanted[r], SCREEN_COLS);
+            }
+            bool shown = rowShown(r);
+            if (!shown && stale_since[r] < 0) stale_since[r] = sim::now_ms;
+            if (shown && stale_since[r] >= 0) {
+                double age = sim::now_ms - stale_since[r];
+                stale_max = fmax(stale_max, age);
+                stale_total += age;
+                stale_count++;
+                stale_since[r] = -1;
+            }
+        }
+    }
+    long writes = Controller1.Screen.writes - writes0;
+    long bytes = Controller1.Screen.bytes - bytes0;
+    long prints = writes / 2;  // each write is a cursor move and a print
+    double link = (bytes + prints * SCREEN_WRITE_OVERHEAD) / (double)seconds;
+
+    // With the sticks still, everything must catch up
+    Controller1.Axis1.val = Controller1.Axis2.val = 0;
+    for (int t = 0; t < 2000; t += DRIVE_PERIOD_MS) {
+        driver_tick();
+        task::sleep(DRIVE_PERIOD_MS);
+    }
+    bool ok = true;
+    for (int r = 0; r < SCREEN_ROWS; r++) {
+        if (!rowShown(r)) {
+            printf("FAIL: line %d shows \"%.*s\", wants \"%.*s\"\n", r + 1, SCREEN_COLS,
+                   Controller1.Screen.text[r], SCREEN_COLS, screen_wanted[r]);
+            ok = false;
+        }
+    }
+    if (link > CONTROLLER_SCREEN_BYTES_PER_S) {
+        printf("FAIL: %.0f bytes/s over the budget of %d\n", link, CONTROLLER_SCREEN_BYTES_PER_S);
+        ok = false;
+    }
+
+    long old_prints = ticks + power_changes + changes[SPINNER_LINE - 1];
+    printf("%d s of driving, %ld control ticks\n", seconds, ticks);
+    printf("changes  lines 1-3 changed %.1f, %.1f, %.1f times/s\n", changes[0] / (double)seconds,
+           changes[1] / (double)seconds, changes[2] / (double)seconds);
+    printf("before   %.0f prints/s, %.0f bytes/s\n", old_prints / (double)seconds,
+           old_prints * (SCREEN_WRITE_OVERHEAD + SCREEN_COLS) / (double)seconds);
+    printf("sent     %.1f prints/s, %.0f text bytes/s, %.0f bytes/s estimated (budget %d)\n",
+           prints / (double)seconds, bytes / (double)seconds, link, CONTROLLER_SCREEN_BYTES_PER_S);
+    printf("stale    worst %.0f ms, average %.0f ms\n", stale_max, stale_count ? stale_total / stale_count : 0.);
+
+    // The same driving again, with the screen work in the loop
+    rng_state = 12345;
+    for (long tick = 0; tick < ticks; tick++) {
+        driverInput();
+        timedTick(true, before);
+        task::sleep(DRIVE_PERIOD_MS);
+    }
+    printf("tick     %.2f us average, %.1f us worst; with the screen work inline %.2f us, %.1f us\n",
+           now.total_us / now.ticks, now.max_us, before.total_us / before.ticks, before.max_us);
+    printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
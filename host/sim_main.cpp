@@ -0,0 +1,117 @@
+/*
+ * Runs a robot program's autonomous routine on the host against the simulated
+ * robot in host/vex.h and reports time used, the time of each step (for
+ * programs that run step tables), distance per motor and where the robot
+ * ended up. Time is virtual, so a 15 s routine takes milliseconds. For a
+ * program with odometry it also prints the pose the program measured and
+ * fails (exit status 1) if that is further than POSE_TOLERANCE_M or
+ * HEADING_TOLERANCE_DEG from where the simulated robot really is.
+ *
+ * Every program in the repo builds this way, except Examples/Tank Control,
+ * which uses motors its robot-config.h does not declare.
+ *
+ * Build (the program's main() is renamed so this file can call it):
+ *   g++ -O2 -std=c++11 -Ihost -include vex.h -Dmain=robot_main -c "Arcade Drive final.contents/main.cpp" -o robot.o
+ *   g++ -O2 -std=c++11 -Ihost host/vex.cpp host/sim_main.cpp robot.o -o sim -lpthread
+ * Run:
+ *   ./sim [--left P,P,..] [--right P,P,..] [auton_state]
+ * --left and --right give the drivetrain's motor ports (1 to 21, up to 4 a
+ * side) for a program whose robot-config.h differs from the default of
+ * left 10,9,20 and right 1,2,12.
+ */
+#include "vex.h"
+
+#include <chrono>
+#include <cstring>
+
+int robot_main();
+// Not every program has these
+extern int autonState __attribute__((weak));
+extern int auton_step_ms[] __attribute__((weak));
+extern int auton_steps_run __attribute__((weak));
+struct Pose {  // as in the program
+    double x;
+    double y;
+    double theta;
+};
+Pose getPose() __attribute__((weak));
+
+const double POSE_TOLERANCE_M = 0.05;
+const double HEADING_TOLERANCE_DEG = 3.;
+
+// Parse "P,P,.." into side (0-based ports, -1 for unused entries); false if not valid
+static bool parsePorts(const char *arg, int side[4]) {
+    for (int i = 0; i < 4; i++) side[i] = -1;
+    int n = 0;
+    for (const char *p = arg; *p; p++) {
+        char *end;
+        long port = strtol(p, &end, 10);
+        if (end == p || port < 1 || port > sim::NUM_PORTS || n == 4 || (*end && *end != ',')) return false;
+        side[n++] = (int)port - 1;
+        p = *end ? end : end - 1;
+    }
+    return n > 0;
+}
+
+int main(int argc, char **argv) {
+    int auton_state = -1;
+    for (int i = 1; i < argc; i++) {
+        bool left = strcmp(argv[i], "--left") == 0, right = strcmp(argv[i], "--right") == 0;
+        if ((left || right) && i + 1 < argc) {
+            if (!parsePorts(argv[++i], left ? sim::drivetrain.left : sim::drivetrain.right)) {
+                printf("bad port list: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (argv[i][0] != '-') {
+            auton_state = atoi(argv[i]);
+        } else {
+            printf("usage: %s [--left P,P,..] [--right P,P,..] [auton_state]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    robot_main();  // pre_auton() and callback registration
+    if (auton_state >= 0 && &autonState) autonState = auton_state;
+    if (!vex::competition::auton) {
+        printf("program has no autonomous routine\n");
+        return 1;
+    }
+    if (!sim::drivetrain_active()) {
+        printf("warning: the program has no motor on some drivetrain port, so the robot does not move; "
+               "give its ports with --left and --right\n");
+    }
+
+    double start = sim::now_ms;
+    std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
+    vex::competition::auton();
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    printf("auton %d finished in %.0f ms (%.0fx real time)\n", &autonState ? autonState : 0, sim::now_ms - start,
+           (sim::now_ms - start) / fmax(wall_ms, 1e-3));
+    if (&auton_steps_run) {
+        for (int i = 0; i < auton_steps_run; i++) printf("  step %d: %d ms\n", i + 1, auton_step_ms[i]);
+    }
+
+    // let the robot settle, then report where each motor ended up
+    vex::task::sleep(500);
+    for (int i = 0; i < sim::NUM_PORTS; i++) {
+        if (!sim::motors[i].used) continue;
+        sim::MotorState &m = sim::motors[i];
+        printf("PORT%-2d %8.1f deg %8.1f rpm\n", i + 1, m.position, m.rpm);
+    }
+    printf("robot at x %.3f m, y %.3f m, heading %.1f deg\n", sim::robot.x, sim::robot.y,
+           sim::robot.heading * 180. / M_PI);
+    if (getPose) {
+        // autonomous() measures from where it started, which is where the simulated robot starts
+        Pose p = getPose();
+        double off = hypot(p.x - sim::robot.x, p.y - sim::robot.y);
+        double heading_off = remainder(p.theta - sim::robot.heading, 2 * M_PI) * 180. / M_PI;
+        printf("odometry x %.3f m, y %.3f m, heading %.1f deg: off by %.3f m, %.1f deg\n", p.x, p.y,
+               p.theta * 180. / M_PI, off, heading_off);
+        if (off > POSE_TOLERANCE_M || fabs(heading_off) > HEADING_TOLERANCE_DEG) {
+            printf("odometry is further than %.2f m or %.0f deg from the robot\n", POSE_TOLERANCE_M,
+                   HEADING_TOLERANCE_DEG);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Host-side bench for the spinner speed control in "Arcade Drive final"
+ * (spinner_loop), on the simulated ratio6_1 motor of host/vex.h.
+ *
+ * Spins the spinner up to spinner_rpm, then loads it as a game object going
+ * through would (a share of the motor's stall torque, for a while) and
+ * reports, for the program's controller and for the motor's own velocity
+ * control (what set_spin() used to do):
+ *   spin-up    time from rest until within SPIN_READY_RPM, and until
+ *              spinner_ready (program only)
+ *   dip        lowest speed while loaded
+ *   recovery   time from the load hitting until back within RECOVERED_RPM
+ *              for good, with the load still on
+ *   release    overshoot when the load goes away, and time until back within
+ *              RECOVERED_RPM
+ *
+ * Then jams the spinner (a load above stall torque) and reports how soon the
+ * jam is detected and how soon the spinner is ready again when running
+ * backwards frees the object, and how soon it gives up when nothing frees it,
+ * which must take JAM_MAX_RETRIES back-outs and one more jam.
+ * The runs above, and a heavy load that slows the spinner without jamming it,
+ * must not count as jams.
+ *
+ * Build and run:
+ *   g++ -std=c++11 -Ihost host/spinner_bench.cpp host/vex.cpp -o spinner_bench -lpthread
+ *   ./spinner_bench [load (0.1)] [load ms (600)]
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+const int SPINNER_PORT = PORT11;
+const double RECOVERED_RPM = 5.;  // back on speed: within this of the target
+const double NEVER = -1.;
+const double JAM_LOAD = 3.;         // times stall torque
+const double FREED_BY_DEG = 30.;    // running back this far frees a jammed object
+
+struct BenchResult {
+    double spin_up_ms;
+    double ready_ms;
+    double dip_rpm;
+    double recovery_ms;
+    double overshoot_rpm;
+    double release_ms;
+};
+
+static double rpm() { return sim::motors[SPINNER_PORT].rpm; }
+
+/**
+ * Record the speed every ms for ms; returns the lowest or highest speed and
+ * how long after the start it was last more than RECOVERED_RPM off target
+ * (0 if never, NEVER if it still is at the end).
+ */
+static double watch(int ms, bool low, double &extreme) {
+    double last_off = 0.;
+    extreme = rpm();
+    for (int t = 1; t <= ms; t++) {
+        task::sleep(1);
+        extreme = low ? fmin(extreme, rpm()) : fmax(extreme, rpm());
+        if (fabs(rpm() - spinner_rpm) > RECOVERED_RPM) last_off = t;
+    }
+    return last_off == ms ? NEVER : last_off;
+}
+
+static BenchResult run(bool program, double load, int load_ms) {
+    BenchResult res = {NEVER, NEVER, 0., NEVER, 0., NEVER};
+    sim::MotorState &m = sim::motors[SPINNER_PORT];
+    m.load = 0.;
+    spinner_state = 0;
+    set_spin();
+    m.rpm = 0.;  // from rest; the model has no friction to stop a coasting spinner
+    task::sleep(100);
+
+    double start = sim::now_ms;
+    if (program) {
+        spinner_state = 1;
+        set_spin();
+    } else {
+        Motor05sp.spin(directionType::fwd, spinner_rpm, velocityUnits::rpm);
+    }
+    while (sim::now_ms - start < 1000) {
+        if (res.spin_up_ms == NEVER && fabs(rpm() - spinner_rpm) < SPIN_READY_RPM) res.spin_up_ms = sim::now_ms - start;
+        if (res.ready_ms == NEVER && program && spinner_ready) res.ready_ms = sim::now_ms - start;
+        task::sleep(1);
+    }
+
+    m.load = load;
+    res.recovery_ms = watch(load_ms, true, res.dip_rpm);
+    m.load = 0.;
+    res.release_ms = watch(500, false, res.overshoot_rpm);
+    res.overshoot_rpm -= spinner_rpm;
+
+    spinner_state = 0;
+    set_spin();
+    return res;
+}
+
+static void report(const char *name, const BenchResult &r) {
+    char ready[16] = "-", recovery[16] = "never", release[16] = "never";
+    if (r.ready_ms != NEVER) snprintf(ready, sizeof(ready), "%.0f", r.ready_ms);
+    if (r.recovery_ms != NEVER) snprintf(recovery, sizeof(recovery), "%.0f", r.recovery_ms);
+    if (r.release_ms != NEVER) snprintf(release, sizeof(release), "%.0f", r.release_ms);
+    printf("%-16s %8.0f %6s %7.0f %9s %10.0f %8s\n", name, r.spin_up_ms, ready, r.dip_rpm, recovery,
+           fmax(r.overshoot_rpm, 0.), release);
+}
+
+// Spin up, then jam; report detection and recovery (or giving up). @return jams counted
+static int jamRun(bool frees) {
+    sim::MotorState &m = sim::motors[SPINNER_PORT];
+    m.load = 0.;
+    spinner_state = 1;
+    set_spin();
+    task::sleep(1000);
+    int jams = spinner_jams;
+    m.load = JAM_LOAD;
+    double hit = sim::now_ms, detected = NEVER, done = NEVER, jam_position = 0.;
+    bool freed = false;
+    while (sim::now_ms - hit < 5000) {
+        task::sleep(1);
+        if (detected == NEVER && spinner_jams > jams) {
+            detected = sim::now_ms - hit;
+            jam_position = m.position;
+        }
+        // The object only resists being pulled in, until running back far enough frees it
+        if (frees && detected != NEVER && jam_position - m.position > FREED_BY_DEG) freed = true;
+        m.load = freed || m.rpm < 0 ? 0. : JAM_LOAD;
+        if (frees ? (freed && spinner_ready) : spinner_state == 0) {
+            done = sim::now_ms - hit;
+            break;
+        }
+    }
+    m.load = 0.;
+    char det[16] = "never", fin[16] = "never";
+    if (detected != NEVER) snprintf(det, sizeof(det), "%.0f ms", detected);
+    if (done != NEVER) snprintf(fin, sizeof(fin), "%.0f ms", done);
+    printf("%-12s detected after %s, %s after %s, %d jam%s counted\n", frees ? "jam, freed" : "jam, stuck", det,
+           frees ? "ready again" : "gave up", fin, spinner_jams - jams, spinner_jams - jams == 1 ? "" : "s");
+    spinner_state = 0;
+    set_spin();
+    return spinner_jams - jams;
+}
+
+int main(int argc, char **argv) {
+    double load = argc > 1 ? atof(argv[1]) : 0.1;
+    int load_ms = argc > 2 ? atoi(argv[2]) : 600;
+    start_spinner_control();
+    printf("target %.0f rpm, load %.0f%% of stall torque for %d ms\n", spinner_rpm, load * 100, load_ms);
+    printf("%-16s %8s %6s %7s %9s %10s %8s\n", "", "spin-up", "ready", "dip", "recovery", "overshoot", "release");
+    printf("%-16s %8s %6s %7s %9s %10s %8s\n", "", "ms", "ms", "rpm", "ms", "rpm", "ms");
+    report("motor velocity", run(false, load, load_ms));
+    report("spinner_loop", run(true, load, load_ms));
+
+    bool ok = true;
+    run(true, 0.6, load_ms);  // slows to about 240 rpm, not a jam
+    if (spinner_jams > 0) {
+        printf("FAIL: %d jams counted without a jam\n", spinner_jams);
+        ok = false;
+    }
+    printf("\n");
+    jamRun(true);
+    int stuck_jams = jamRun(false);
+    if (stuck_jams != JAM_MAX_RETRIES + 1) {
+        printf("FAIL: gave up after %d jams, expected %d back-outs and one more\n", stuck_jams, JAM_MAX_RETRIES);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+/*
+ * Host-side reader/writer for the tunables file of "Arcade Drive final"
+ * (TUNABLES_FILE on the brain's SD card), and a check of the robot's own
+ * load/save code against a directory standing in for the card.
+ *
+ *   tunables_tool show FILE                 print every value
+ *   tunables_tool set FILE name=value ...   change values; a missing or
+ *                                           unusable FILE starts from the
+ *                                           program's built-in values
+ *   tunables_tool check                     round trip, corruption,
+ *                                           truncation, version and range
+ *                                           checks, saving after a change
+ *
+ * Names are those show prints: curve_preset, deadzone, spinner_rpm,
+ * spinner_rpm_mult, drive_ks, drive_kv, drive_ka, turn_ks, turn_kv, turn_ka
+ * and auton12.N / auton34.N for the value of step N of a routine.
+ *
+ * The program is compiled in, so this uses the robot's own encoder and
+ * decoder. Build:
+ *   g++ -std=c++11 -Ihost host/tunables_tool.cpp host/vex.cpp -o tunables_tool -lpthread
+ */
+#include "vex.h"
+#define main robot_main  // the program's main() is never called here
+#include "../Arcade Drive final.contents/main.cpp"
+#undef main
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+const char *ROUTINE_NAMES[NUM_AUTON_ROUTINES] = {"auton12", "auton34"};
+
+// The double a name refers to, or nullptr; curve_preset is handled by the caller
+static double *field(Tunables &t, const std::string &name) {
+    if (name == "deadzone") return &t.deadzone;
+    if (name == "spinner_rpm") return &t.spinner_rpm;
+    if (name == "spinner_rpm_mult") return &t.spinner_rpm_mult;
+    if (name == "drive_ks") return &t.drive_ff.ks;
+    if (name == "drive_kv") return &t.drive_ff.kv;
+    if (name == "drive_ka") return &t.drive_ff.ka;
+    if (name == "turn_ks") return &t.turn_ff.ks;
+    if (name == "turn_kv") return &t.turn_ff.kv;
+    if (name == "turn_ka") return &t.turn_ff.ka;
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        std::string prefix = std::string(ROUTINE_NAMES[r]) + ".";
+        if (name.compare(0, prefix.size(), prefix) != 0) continue;
+        char *end;
+        long i = strtol(name.c_str() + prefix.size(), &end, 10);
+        if (*end || end == name.c_str() + prefix.size() || i < 0 || i >= t.step_count[r]) return nullptr;
+        return &t.step_value[r][i];
+    }
+    return nullptr;
+}
+
+static void show(const Tunables &t) {
+    printf("curve_preset      %d  (smooth_power %.2f)\n", t.curve_preset,
+           MIN_SMOOTH_POWER + t.curve_preset * smooth_power_step);
+    printf("deadzone          %g\n", t.deadzone);
+    printf("spinner_rpm       %g\n", t.spinner_rpm);
+    printf("spinner_rpm_mult  %g\n", t.spinner_rpm_mult);
+    printf("drive_ks          %g V\n", t.drive_ff.ks);
+    printf("drive_kv          %g V/(m/s)\n", t.drive_ff.kv);
+    printf("drive_ka          %g V/(m/s^2)\n", t.drive_ff.ka);
+    printf("turn_ks           %g V\n", t.turn_ff.ks);
+    printf("turn_kv           %g V/(m/s)\n", t.turn_ff.kv);
+    printf("turn_ka           %g V/(m/s^2)\n", t.turn_ff.ka);
+    for (int r = 0; r < NUM_AUTON_ROUTINES; r++) {
+        bool current = t.step_count[r] == routineStepCount(auton_routines[r]);
+        printf("%s          %d steps%s\n", ROUTINE_NAMES[r], t.step_count[r],
+               current ? "" : ", does not match the program's routine (ignored)");
+        for (int i = 0; i < t.step_count[r]; i++) printf("  %s.%d %g\n", ROUTINE_NAMES[r], i, t.step_value[r][i]);
+    }
+}
+
+// Read and decode a file; false if it cannot be read or is unusable
+static bool readFile(const char *path, Tunables &t) {
+    uint8_t buf[TUNABLES_FILE_BYTES + 1];
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    int len = (int)fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    return decodeTunables(buf, len, t);
+}
+
+static bool writeFile(const char *path, const Tunables &t) {
+    uint8_t buf[TUNABLES_FILE_BYTES];
+    encodeTunables(t, buf);
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(buf, 1, sizeof(buf), f) == sizeof(buf);
+    return fclose(f) == 0 && ok;
+}
+
+static int setValues(const char *path, int count, char **assignments) {
+    Tunables t;
+    if (!readFile(path, t)) {
+        printf("%s missing or unusable, starting from the built-in values\n", path);
+        t = currentTunables();
+    }
+    for (int i = 0; i < count; i++) {
+        std::string arg = assignments[i];
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            printf("expected name=value: %s\n", assignments[i]);
+            return 1;
+        }
+        std::string name = arg.substr(0, eq);
+        char *end;
+        double value = strtod(arg.c_str() + eq + 1, &end);
+        if (*end || end == arg.c_str() + eq + 1) {
+            printf("not a number: %s\n", assignments[i]);
+            return 1;
+        }
+        double *v = field(t, name);
+        if (name == "curve_preset") t.curve_preset = (int)value;
+        else if (v) *v = value;
+        else {
+            printf("unknown name: %s\n", name.c_str());
+            return 1;
+        }
+    }
+    // Only write what the robot would accept
+    uint8_t buf[TUNABLES_FILE_BYTES];
+    Tunables check;
+    encodeTunables(t, buf);
+    if (!decodeTunables(buf, TUNABLES_FILE_BYTES, check)) {
+        printf("a value is out of range, %s not written\n", path);
+        return 1;
+    }
+    if (!writeFile(path, t)) {
+        printf("cannot write %s\n", path);
+        return 1;
+    }
+    show(check);
+    return 0;
+}
+
+/* Checks of the robot's loadTunables() / saveTunablesIfChanged() */
+
+static bool check_ok = true;
+
+static void expect(bool cond, const char *what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        check_ok = false;
+    }
+}
+
+static std::string card_path;
+
+static bool cardFile(std::vector<uint8_t> &buf) {
+    FILE *f = fopen(card_path.c_str(), "rb");
+    if (!f) return false;
+    buf.assign(TUNABLES_FILE_BYTES + 16, 0);
+    buf.resize(fread(buf.data(), 1, buf.size(), f));
+    fclose(f);
+    return true;
+}
+
+static void putCardFile(const uint8_t *buf, size_t len) {
+    FILE *f = fopen(card_path.c_str(), "wb");
+    fwrite(buf, 1, len, f);
+    fclose(f);
+}
+
+// Encoding goes through f32, so compare at that precision
+static bool same(const Tunables &a, const Tunables &b) {
+    uint8_t ea[TUNABLES_FILE_BYTES], eb[TUNABLES_FILE_BYTES];
+    encodeTunables(a, ea);
+    encodeTunables(b, eb);
+    return memcmp(ea, eb, TUNABLES_FILE_BYTES) == 0;
+}
+
+// Loading buf must be refused and leave the current values alone
+static void expectRejected(const uint8_t *buf, size_t len, const char *what) {
+    Tunables before = currentTunables();
+    putCardFile(buf, len);
+    bool loaded = loadTunables();
+    expect(!loaded && same(before, currentTunables()), what);
+}
+
+static int check() {
+    const Tunables defaults = currentTunables();
+    char dir[] = "/tmp/tunables_checkXXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("cannot make a directory for the SD card\n");
+        return 1;
+    }
+    card_path = std::string(dir) + "/" + TUNABLES_FILE;
+    std::vector<uint8_t> file;
+
+    // No card, then an empty card: built-in values, nothing written
+    sim::sdcard_dir = nullptr;
+    expect(!loadTunables() && same(defaults, currentTunables()), "no card keeps the defaults");
+    spinner_rpm_up();
+    expect(saveTunablesIfChanged(), "no card, save is a no-op");
+    applyTunables(defaults);
+    sim::sdcard_dir = dir;
+    expect(!loadTunables() && same(defaults, currentTunables()), "no file keeps the defaults");
+    expect(saveTunablesIfChanged() && !cardFile(file), "unchanged values are not written");
+
+    // Changes on the controller, and a characterization, get saved and load back
+    spinner_rpm_up();
+    smooth_power_down();
+    drive_ff.kv = 8.5;
+    turn_ff.ks = 0.61;
+    auton34_steps[1].value = 0.65;
+    Tunables changed = currentTunables();
+    expect(saveTunablesIfChanged() && cardFile(file) && file.size() == (size_t)TUNABLES_FILE_BYTES,
+           "changed values are written");
+    std::vector<uint8_t> good = file;
+    applyTunables(defaults);
+    expect(loadTunables() && same(changed, currentTunables()), "saved values load back");
+    prepareAutonPlans();
+    expect(fabs(auton_plans[2].steps[1].step.value - (0.65 - 0.3 * tan(M_PI / 4))) < 1e-6,
+           "loaded step values reach the auton plans");
+    remove(card_path.c_str());
+    expect(saveTunablesIfChanged() && !cardFile(file), "values just loaded are not written again");
+
+    // Damaged files are refused: every byte, every length, other versions
+    applyTunables(defaults);
+    for (int i = 0; i < TUNABLES_FILE_BYTES; i++) {
+        std::vector<uint8_t> bad = good;
+        bad[i] ^= 0x5a;
+        char what[64];
+        snprintf(what, sizeof(what), "byte %d damaged", i);
+        expectRejected(bad.data(), bad.size(), what);
+    }
+    for (int len = 0; len < TUNABLES_FILE_BYTES; len++) {
+        expectRejected(good.data(), len, "truncated file");
+    }
+    std::vector<uint8_t> longer = good;
+    longer.push_back(0);
+    expectRejected(longer.data(), longer.size(), "file with extra bytes");
+    std::vector<uint8_t> other = good;
+    putU16(other.data() + 4, TUNABLES_VERSION + 1);
+    putU32(other.data() + TUNABLES_FILE_BYTES - 4, crc32(other.data(), TUNABLES_FILE_BYTES - 4));
+    expectRejected(other.data(), other.size(), "other version");
+
+    // Intact files with values out of range are refused too
+    const double bad_values[][2] = {{0, 0.9}, {1, 0.}, {2, 1.}, {4, -1.}, {4, NAN}, {5, INFINITY}};
+    for (const double *bv : bad_values) {
+        Tunables t = changed;
+        double *values[] = {&t.deadzone, &t.spinner_rpm, &t.spinner_rpm_mult,
+                            &t.drive_ff.ks, &t.drive_ff.kv, &t.drive_ff.ka};
+        *values[(int)bv[0]] = bv[1];
+        uint8_t buf[TUNABLES_FILE_BYTES];
+        encodeTunables(t, buf);
+        expectRejected(buf, TUNABLES_FILE_BYTES, "value out of range");
+    }
+
+    // A routine that has changed since the file was written keeps its own values
+    Tunables edited = changed;
+    edited.step_count[0] = 3;
+    edited.step_value[0][0] = 9.;
+    uint8_t buf[TUNABLES_FILE_BYTES];
+    encodeTunables(edited, buf);
+    putCardFile(buf, TUNABLES_FILE_BYTES);
+    expect(loadTunables() && auton12_steps[0].value == defaults.step_value[0][0] &&
+           fabs(auton34_steps[1].value - 0.65) < 1e-6 && fabs(drive_ff.kv - 8.5) < 1e-6,
+           "stale routine values are skipped, the rest used");
+
+    // Values the load would refuse are never saved, or the whole file would be lost
+    applyTunables(defaults);
+    for (int i = 0; i < 10; i++) spinner_rpm_up();
+    expect(spinner_rpm == SPINNER_MAX_RPM && saveTunablesIfChanged() && loadTunables() &&
+           spinner_rpm == SPINNER_MAX_RPM, "spinner speed stops at the top of the range and loads back");
+    drive_ff.kv = 0.;
+    expect(!saveTunablesIfChanged() && loadTunables() && fabs(drive_ff.kv - defaults.drive_ff.kv) < 1e-5,
+           "out of range values are not saved");
+
+    remove(card_path.c_str());
+    rmdir(dir);
+    printf(check_ok ? "OK\n" : "FAILED\n");
+    return check_ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    std::string cmd = argc > 1 ? argv[1] : "";
+    if (cmd == "check" && argc == 2) return check();
+    if (cmd == "show" && argc == 3) {
+        Tunables t;
+        if (!readFile(argv[2], t)) {
+            printf("%s missing or unusable\n", argv[2]);
+            return 1;
+        }
+        show(t);
+        return 0;
+    }
+    if (cmd == "set" && argc >= 3) return setValues(argv[2], argc - 3, argv + 3);
+    printf("usage: %s show FILE | set FILE name=value ... | check\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,225 @@
+/*
+ * Simulation state and time stepping for the host stand-in of the VEX API.
+ */
+#include "vex.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+MotorState motors[NUM_PORTS];
+double now_ms = 0.;
+
+Drivetrain drivetrain = {
+    {vex::PORT10, vex::PORT9, vex::PORT20, -1},
+    {vex::PORT1, vex::PORT2, vex::PORT12, -1},
+    0.127, 1., 0.42,
+    6., 0.2,
+    1., 0.05, 0.3,
+};
+RobotState robot;
+const char *sdcard_dir = nullptr;
+
+const double GRAVITY = 9.81;
+const double RPM_TO_RAD_S = 2. * M_PI / 60.;
+
+// Smooth sign, for friction that does not chatter around zero speed
+static double smooth_sign(double v, double scale) { return tanh(v / scale); }
+
+// Torque on a motor's output shaft, Nm, for STEP_MS at its present velocity.
+// The motor's own controller sets the voltage: the commanded voltage, velocity
+// PI while spinning at a velocity, nothing when coasting, a short circuit when
+// braking, position PD when holding.
+static double motor_torque(MotorState &m, double dt) {
+    double stall = STALL_TORQUE_NM * 200. / m.max_rpm;
+    double load = m.load * stall * smooth_sign(m.rpm, 1.);
+    double speed = m.rpm / m.max_rpm;
+    double u;  // fraction of full voltage
+    if (m.spinning && m.voltage_mode) {
+        m.holding = false;
+        m.integral = 0.;
+        u = m.target_volts / MOTOR_VOLTS;
+    } else if (m.spinning) {
+        m.holding = false;
+        double err = (m.target_rpm - m.rpm) / m.max_rpm;
+        u = m.target_rpm / m.max_rpm + VELOCITY_KP * err + VELOCITY_KI * m.integral;
+        if (fabs(u) < 1.) m.integral += err * dt / 1000.;  // no windup while saturated
+    } else {
+        m.integral = 0.;
+        if (m.brake == vex::brakeType::coast) {
+            m.holding = false;
+            m.volts = m.amps = 0.;
+            return -load;
+        }
+        if (m.brake == vex::brakeType::brake) {
+            m.holding = false;
+            u = 0.;
+        } else {
+            if (!m.holding) {
+                m.holding = true;
+                m.hold_position = m.position;
+            }
+            u = HOLD_KP * (m.hold_position - m.position) - HOLD_KD * speed;
+        }
+    }
+    u = fmax(-1., fmin(1., u));
+    double i = u - speed;  // fraction of stall current, back EMF included
+    m.volts = u * MOTOR_VOLTS;
+    m.amps = i * STALL_AMPS;
+    return i * stall - load;
+}
+
+static void move_motor(MotorState &m, double rpm, double dt) {
+    m.rpm = rpm;
+    m.position += rpm * 6. * dt / 1000.;  // rpm -> deg/ms
+}
+
+bool drivetrain_active() {
+    int n = 0;
+    for (int i = 0; i < 4; i++) {
+        int ports[2] = {drivetrain.left[i], drivetrain.right[i]};
+        for (int p : ports) {
+            if (p < 0) continue;
+            if (p >= NUM_PORTS || !motors[p].used) return false;
+            n++;
+        }
+    }
+    return n > 0;
+}
+
+static bool in_drivetrain(int port) {
+    for (int i = 0; i < 4; i++) {
+        if (drivetrain.left[i] == port || drivetrain.right[i] == port) return true;
+    }
+    return false;
+}
+
+// One step of the robot: motor torques -> wheel forces -> speed and turn rate,
+// then the motors follow the wheels
+static void step_drivetrain(double dt) {
+    const Drivetrain &d = drivetrain;
+    double wheel_radius = d.wheel_diameter / 2;
+    double weight = d.mass * GRAVITY;
+    double force[2] = {0., 0.};
+    const int *sides[2] = {d.left, d.right};
+    for (int s = 0; s < 2; s++) {
+        for (int i = 0; i < 4; i++) {
+            if (sides[s][i] >= 0) force[s] += motor_torque(motors[sides[s][i]], dt) / d.gear_ratio / wheel_radius;
+        }
+        double grip = d.friction * weight / 2;
+        force[s] = fmax(-grip, fmin(grip, force[s]));
+    }
+    double accel = (force[0] + force[1] - d.rolling * weight * smooth_sign(robot.speed, 0.01)) / d.mass;
+    double turn_accel = ((force[1] - force[0]) * d.track_width / 2 -
+                         d.scrub * weight * d.track_width / 4 * smooth_sign(robot.turn_rate, 0.05)) / d.inertia;
+    double sec = dt / 1000.;
+    robot.speed += accel * sec;
+    robot.turn_rate += turn_accel * sec;
+    robot.heading += robot.turn_rate * sec;
+    robot.x += robot.speed * cos(robot.heading) * sec;
+    robot.y += robot.speed * sin(robot.heading) * sec;
+    
+    double wheel_speed[2] = {robot.speed - robot.turn_rate * d.track_width / 2,
+                             robot.speed + robot.turn_rate * d.track_width / 2};
+    for (int s = 0; s < 2; s++) {
+        double rpm = wheel_speed[s] / (M_PI * d.wheel_diameter) * 60. / d.gear_ratio;
+        for (int i = 0; i < 4; i++) {
+            if (sides[s][i] >= 0) move_motor(motors[sides[s][i]], rpm, dt);
+        }
+    }
+}
+
+// One step of a motor turning its own load
+static void step_motor(MotorState &m, double dt) {
+    double stall = STALL_TORQUE_NM * 200. / m.max_rpm;
+    double inertia = MOTOR_LOAD_TAU_MS / 1000. * stall / (m.max_rpm * RPM_TO_RAD_S);
+    double torque = motor_torque(m, dt);
+    move_motor(m, m.rpm + torque / inertia * dt / 1000. / RPM_TO_RAD_S, dt);
+}
+
+void advance(double ms) {
+    double end = now_ms + ms;
+    while (now_ms < end) {
+        double dt = fmin(STEP_MS, end - now_ms);
+        bool drive = drivetrain_active();
+        if (drive) step_drivetrain(dt);
+        for (int i = 0; i < NUM_PORTS; i++) {
+            if (motors[i].used && !(drive && in_drivetrain(i))) step_motor(motors[i], dt);
+        }
+        now_ms += dt;
+    }
+}
+
+struct Task {
+    double wake_ms;       // virtual time at which the task wants to run again
+    unsigned long order;  // breaks ties first come, first served
+    bool running;         // has been handed control
+    std::condition_variable cv;
+};
+
+// Never destroyed, so tasks still blocked when the program exits stay valid
+static std::mutex &lock_ = *new std::mutex;
+static std::vector<Task *> &tasks = *new std::vector<Task *>;
+static unsigned long next_order = 0;
+static thread_local Task *self = nullptr;
+
+static Task *add_task(double wake) {
+    Task *t = new Task;
+    t->wake_ms = wake;
+    t->order = next_order++;
+    t->running = false;
+    tasks.push_back(t);
+    return t;
+}
+
+// Hand control to the task that should run next; returns when it is me again.
+// Called with lock_ held by the task giving up control (me == nullptr if it ended).
+static void switch_task(std::unique_lock<std::mutex> &lk, Task *me) {
+    Task *next = nullptr;
+    for (Task *t : tasks) {
+        if (!next || t->wake_ms < next->wake_ms || (t->wake_ms == next->wake_ms && t->order < next->order)) next = t;
+    }
+    if (!next) return;
+    if (next->wake_ms > now_ms) advance(next->wake_ms - now_ms);
+    if (next == me) return;
+    next->running = true;
+    next->cv.notify_one();
+    if (!me) return;
+    me->running = false;
+    me->cv.wait(lk, [me] { return me->running; });
+}
+
+void sleep(double ms) {
+    std::unique_lock<std::mutex> lk(lock_);
+    if (!self) self = add_task(now_ms);  // first sleep of the main program
+    self->wake_ms = now_ms + ms;
+    self->order = next_order++;
+    switch_task(lk, self);
+}
+
+void start_task(int (*callback)(void)) {
+    std::unique_lock<std::mutex> lk(lock_);
+    if (!self) self = add_task(now_ms);
+    Task *t = add_task(now_ms);  // starts when the creating task next sleeps
+    std::thread([t, callback] {
+        {
+            std::unique_lock<std::mutex> lk(lock_);
+            self = t;
+            t->cv.wait(lk, [t] { return t->running; });
+        }
+        callback();
+        std::unique_lock<std::mutex> lk(lock_);
+        for (size_t i = 0; i < tasks.size(); i++) {
+            if (tasks[i] == t) tasks.erase(tasks.begin() + i);
+        }
+        switch_task(lk, nullptr);
+    }).detach();
+}
+
+}  // namespace sim
+
+void (*vex::competition::auton)(void) = nullptr;
+void (*vex::competition::driver)(void) = nullptr;
@@ -0,0 +1,371 @@
+/*
+ * Host stand-in for the subset of the VEX V5 C++ API used by the robot programs.
+ *
+ * Lets a program's main.cpp compile and run on a Linux host. Motors are
+ * simulated as DC motors under the V5's own velocity control, and the drive
+ * motors move a robot with mass and inertia (see Drivetrain below). Time is
+ * virtual: task::sleep() advances the simulation clock instead of waiting, and
+ * background tasks are scheduled on that clock, so a run takes a small
+ * fraction of real time.
+ * See host/sim_main.cpp for how to build a program with it.
+ */
+#ifndef HOST_VEX_H
+#define HOST_VEX_H
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace vex {
+
+enum class directionType { fwd, rev };
+enum class brakeType { coast, brake, hold };
+enum class percentUnits { pct };
+enum class velocityUnits { pct, rpm, dps };
+enum class powerUnits { watt };
+enum class torqueUnits { Nm, InLb };
+enum class rotationUnits { deg, rev, raw };
+enum class currentUnits { amp };
+enum class voltageUnits { volt, mV };
+enum class temperatureUnits { celsius, fahrenheit };
+enum class timeUnits { sec, msec };
+enum class gearSetting { ratio36_1, ratio18_1, ratio6_1 };
+
+const directionType fwd = directionType::fwd;
+const directionType rev = directionType::rev;
+const brakeType coast = brakeType::coast;
+const brakeType brake = brakeType::brake;
+const brakeType hold = brakeType::hold;
+const percentUnits pct = percentUnits::pct;
+
+enum {
+    PORT1 = 0, PORT2, PORT3, PORT4, PORT5, PORT6, PORT7, PORT8, PORT9, PORT10, PORT11,
+    PORT12, PORT13, PORT14, PORT15, PORT16, PORT17, PORT18, PORT19, PORT20, PORT21
+};
+
+}  // namespace vex
+
+/* Simulation state shared by all devices */
+namespace sim {
+
+const int NUM_PORTS = 21;
+
+/* Motor state. Velocities and positions are those the program sees, so they
+ * already include the motor's reversed flag. */
+struct MotorState {
+    bool used;
+    double max_rpm;       // free speed of the cartridge
+    bool reversed;
+    bool spinning;        // last command was spin, otherwise stopped
+    bool voltage_mode;    // spinning at a set voltage rather than a set velocity
+    double target_rpm;    // commanded output shaft velocity, signed
+    double target_volts;  // commanded voltage, signed
+    vex::brakeType brake;
+    double rpm;           // actual output shaft velocity, signed
+    double position;      // output shaft position, degrees
+    double zero;          // position at the last resetRotation()
+    double load;          // external load torque, 0 (free) to 1 (stall torque)
+    double volts;         // applied by the motor's controller
+    double amps;
+    double integral;      // velocity controller state
+    bool holding;         // hold position controller state
+    double hold_position;
+};
+
+extern MotorState motors[NUM_PORTS];
+extern double now_ms;
+
+/* Drivetrain. When all of its ports have motors, the motors on each side turn
+ * one set of wheels, and the sides push a robot with mass and moment of
+ * inertia. Wheels do not slip, but the force a side can put down is limited
+ * by friction. Spinning a motor forward (after its reversed flag) drives its
+ * side forward. Other motors turn a load of their own, MOTOR_LOAD_TAU_MS. */
+struct Drivetrain {
+    int left[4];            // ports, -1 for unused entries
+    int right[4];
+    double wheel_diameter;  // m
+    double gear_ratio;      // wheel turns per motor output shaft turn
+    double track_width;     // m
+    double mass;            // kg
+    double inertia;         // kg m^2 about the center
+    double friction;        // wheel to floor friction coefficient
+    double rolling;         // rolling resistance, fraction of weight
+    double scrub;           // resistance of the wheels to turning on the spot, fraction of weight
+};
+extern Drivetrain drivetrain;  // defaults to the club robot's drive ports (those of every
+                               // robot-config.h in the repo) and size
+// All drivetrain ports have motors? If not, every motor turns a load of its own
+bool drivetrain_active();
+
+/* Where the robot really is, from the drivetrain model. Starts at the origin
+ * facing +x; heading is counter-clockwise. */
+struct RobotState {
+    double x, y;         // m
+    double heading;      // rad
+    double speed;        // m/s
+    double turn_rate;    // rad/s
+};
+extern RobotState robot;
+
+/* Host directory that stands in for the brain's SD card, files by name.
+ * nullptr (the default) runs without a card. */
+extern const char *sdcard_dir;
+
+/* Tasks. Each vex::task runs on its own thread, but like the V5 scheduler only
+ * one runs at a time and control changes hands only in task::sleep(). The
+ * sleeping task with the earliest wake-up time runs next, and the clock jumps
+ * straight to that time, so simulated time costs nothing to wait through. */
+void start_task(int (*callback)(void));
+void sleep(double ms);
+
+// V5 motor: 11 W; these are for the 18:1 (200 rpm) cartridge and scale with it
+const double MOTOR_VOLTS = 12.;
+const double STALL_TORQUE_NM = 2.1;
+const double STALL_AMPS = 2.5;
+// Velocity controller gains, per unit of velocity error relative to free speed
+const double VELOCITY_KP = 2.;
+const double VELOCITY_KI = 20.;   // per second
+// Hold position controller, fraction of full voltage per degree and per unit velocity
+const double HOLD_KP = 0.05;
+const double HOLD_KD = 1.;
+const double MOTOR_LOAD_TAU_MS = 50.;  // spin-up time constant of a motor that is not in the drivetrain
+const double BATTERY_VOLTS = 12.8;     // charged, no load
+const double BATTERY_OHMS = 0.1;       // internal resistance, with wiring
+const double STEP_MS = 1.;
+
+// Advance all simulated devices by ms of virtual time
+void advance(double ms);
+
+}  // namespace sim
+
+namespace vex {
+
+/* A screen as text. Keeps what has been printed where, and counts writes and
+ * bytes sent (the text of each print, plus one write per cursor move or clear)
+ * so a program's use of the controller link can be measured. */
+class lcd {
+public:
+    static const int ROWS = 12;
+    static const int COLS = 80;
+    char text[ROWS][COLS + 1];
+    long writes = 0;
+    long bytes = 0;
+
+    lcd() { clearScreen(); writes = 0; }
+    void setCursor(int r, int c) {
+        row = r < 1 ? 0 : (r > ROWS ? ROWS - 1 : r - 1);
+        col = c < 1 ? 0 : (c > COLS ? COLS : c - 1);
+        writes++;
+    }
+    void clearLine(int line) { setCursor(line, 1); clearLine(); }
+    void clearLine() {
+        memset(text[row], ' ', COLS);
+        text[row][COLS] = 0;
+        writes++;
+    }
+    void clearScreen() {
+        for (int r = 0; r < ROWS; r++) {
+            memset(text[r], ' ', COLS);
+            text[r][COLS] = 0;
+        }
+        row = col = 0;
+        writes++;
+    }
+    void print(const char *format, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        for (const char *p = buf; *p && col < COLS; p++) text[row][col++] = *p;
+        bytes += strlen(buf);
+        writes++;
+    }
+    void render() {}
+    void render(bool /*double_buffer*/, bool /*wait_vsync*/) {}
+    void pressed(void (* /*callback*/)(void)) {}
+
+private:
+    int row = 0;
+    int col = 0;
+};
+
+// Virtual time, like Brain.timer()
+class timer {
+public:
+    static uint32_t system() { return (uint32_t)sim::now_ms; }
+    static uint64_t systemHighResolution() { return (uint64_t)(sim::now_ms * 1000.); }
+};
+
+class brain {
+public:
+    class sdcard {
+    public:
+        bool isInserted() { return sim::sdcard_dir != nullptr; }
+        int32_t loadfile(const char *name, uint8_t *buffer, int32_t len) {
+            FILE *f = open(name, "rb");
+            if (!f) return 0;
+            int32_t n = (int32_t)fread(buffer, 1, len, f);
+            fclose(f);
+            return n;
+        }
+        int32_t savefile(const char *name, uint8_t *buffer, int32_t len) {
+            FILE *f = open(name, "wb");
+            if (!f) return 0;
+            int32_t n = (int32_t)fwrite(buffer, 1, len, f);
+            fclose(f);
+            return n;
+        }
+        int32_t appendfile(const char *name, uint8_t *buffer, int32_t len) {
+            FILE *f = open(name, "ab");
+            if (!f) return 0;
+            int32_t n = (int32_t)fwrite(buffer, 1, len, f);
+            fclose(f);
+            return n;
+        }
+        bool exists(const char *name) {
+            FILE *f = open(name, "rb");
+            if (f) fclose(f);
+            return f != nullptr;
+        }
+    private:
+        FILE *open(const char *name, const char *mode) {
+            if (!isInserted()) return nullptr;
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", sim::sdcard_dir, name);
+            return fopen(path, mode);
+        }
+    };
+
+    /* The battery, as an ideal source behind its internal resistance feeding
+     * every motor */
+    class battery {
+    public:
+        double current(currentUnits /*units*/ = currentUnits::amp) {
+            double watts = 0.;
+            for (int i = 0; i < sim::NUM_PORTS; i++) {
+                if (sim::motors[i].used) watts += fabs(sim::motors[i].volts * sim::motors[i].amps);
+            }
+            return watts / sim::BATTERY_VOLTS;
+        }
+        double voltage(voltageUnits units = voltageUnits::volt) {
+            double volts = sim::BATTERY_VOLTS - current() * sim::BATTERY_OHMS;
+            return units == voltageUnits::mV ? volts * 1000. : volts;
+        }
+        uint32_t capacity() { return 100; }
+    };
+
+    lcd Screen;
+    sdcard SDcard;
+    battery Battery;
+    double timer(timeUnits units) { return units == timeUnits::sec ? sim::now_ms / 1000. : sim::now_ms; }
+};
+
+class motor {
+public:
+    motor(int32_t index, gearSetting gears = gearSetting::ratio18_1, bool reverse = false) : port(index) {
+        sim::MotorState &s = sim::motors[port];
+        s.used = true;
+        s.max_rpm = gears == gearSetting::ratio36_1 ? 100. : (gears == gearSetting::ratio6_1 ? 600. : 200.);
+        s.reversed = reverse;
+    }
+    motor(int32_t index, bool reverse) : motor(index, gearSetting::ratio18_1, reverse) {}
+
+    int32_t index() { return port; }
+
+    void spin(directionType dir, double velocity, percentUnits /*units*/) {
+        command(dir, velocity / 100. * state().max_rpm);
+    }
+    void spin(directionType dir, double velocity, velocityUnits units) {
+        double rpm = units == velocityUnits::rpm ? velocity
+                   : (units == velocityUnits::dps ? velocity / 6. : velocity / 100. * state().max_rpm);
+        command(dir, rpm);
+    }
+    void spin(directionType dir, double voltage, voltageUnits units) {
+        double volts = units == voltageUnits::mV ? voltage / 1000. : voltage;
+        volts = fmax(-sim::MOTOR_VOLTS, fmin(sim::MOTOR_VOLTS, volts));
+        state().target_volts = dir == directionType::fwd ? volts : -volts;
+        state().voltage_mode = true;
+        state().spinning = true;
+    }
+    void stop() { state().spinning = false; }
+    void stop(brakeType mode) { state().brake = mode; stop(); }
+    void setStopping(brakeType mode) { state().brake = mode; }
+
+    double velocity(velocityUnits units) {
+        double rpm = state().rpm;
+        return units == velocityUnits::rpm ? rpm : (units == velocityUnits::dps ? rpm * 6. : rpm / state().max_rpm * 100.);
+    }
+    double rotation(rotationUnits units) {
+        double deg = state().position - state().zero;
+        return units == rotationUnits::rev ? deg / 360. : deg;
+    }
+    void resetRotation() { state().zero = state().position; }
+
+    double power(powerUnits /*units*/) { return fabs(state().volts * state().amps); }
+    double current(currentUnits /*units*/ = currentUnits::amp) { return fabs(state().amps); }
+    double temperature(temperatureUnits units) { return units == temperatureUnits::celsius ? 25. : 77.; }
+
+private:
+    int32_t port;
+    sim::MotorState &state() { return sim::motors[port]; }
+    void command(directionType dir, double rpm) {
+        double max = state().max_rpm;
+        rpm = fmax(-max, fmin(max, rpm));
+        state().target_rpm = dir == directionType::fwd ? rpm : -rpm;
+        state().voltage_mode = false;
+        state().spinning = true;
+    }
+};
+
+class controller {
+public:
+    class axis {
+    public:
+        int32_t value() { return val; }
+        int32_t position(percentUnits /*units*/) { return val * 100 / 127; }
+        int32_t val = 0;
+    };
+    class button {
+    public:
+        bool pressing() { return down; }
+        void pressed(void (*callback)(void)) { on_press = callback; }
+        void released(void (*callback)(void)) { on_release = callback; }
+        bool down = false;
+        void (*on_press)(void) = nullptr;
+        void (*on_release)(void) = nullptr;
+    };
+
+    axis Axis1, Axis2, Axis3, Axis4;
+    button ButtonL1, ButtonL2, ButtonR1, ButtonR2;
+    button ButtonUp, ButtonDown, ButtonLeft, ButtonRight;
+    button ButtonX, ButtonB, ButtonY, ButtonA;
+    lcd Screen;
+    void rumble(const char * /*pattern*/) {}
+};
+
+class competition {
+public:
+    void autonomous(void (*callback)(void)) { auton = callback; }
+    void drivercontrol(void (*callback)(void)) { driver = callback; }
+    static void (*auton)(void);
+    static void (*driver)(void);
+};
+
+class task {
+public:
+    static const int32_t taskPriorityLow = 1;
+    static const int32_t taskPriorityNormal = 7;
+    static const int32_t taskPriorityHigh = 15;
+
+    task(int (*callback)(void)) { sim::start_task(callback); }
+    task(int (*callback)(void), int32_t /*priority*/) { sim::start_task(callback); }
+    static void sleep(uint32_t time) { sim::sleep(time); }
+};
+
+}  // namespace vex
+
+#endif  // HOST_VEX_H
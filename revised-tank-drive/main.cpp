@@ -18,33 +18,103 @@ const int SPINNER_LINE = 3;
 /* Joystick rescaling - input^(1+smooth_power) outside the dead zone */
 const double DEADZONE = 0.02;
 const double JOY_SCALE = 127.0;
-static double smooth_power = 0.55;
-const double smooth_power_step = 0.05;
-const double MAX_SMOOTH_POWER = 1.0;
-const double MIN_SMOOTH_POWER = -0.75;
+constexpr double smooth_power_step = 0.05;
+constexpr double MAX_SMOOTH_POWER = 1.0;
+constexpr double MIN_SMOOTH_POWER = -0.75;
+
+/* Joystick response presets, one per smooth_power step from MIN_SMOOTH_POWER to
+ * MAX_SMOOTH_POWER. Each table samples t^(1+smooth_power) at CURVE_STEPS+1 points,
+ * t = (input - DEADZONE) / (1 - DEADZONE) from 0 to 1. All tables are generated
+ * by the compiler, so the robot does no pow() at startup or while driving, and
+ * changing smooth_power only changes which table curve_table points to. */
+const int CURVE_STEPS = 1024;
+constexpr int NUM_CURVE_PRESETS = (int)((MAX_SMOOTH_POWER - MIN_SMOOTH_POWER) / smooth_power_step + 0.5) + 1;
+static_assert(MIN_SMOOTH_POWER + (NUM_CURVE_PRESETS - 1) * smooth_power_step > MAX_SMOOTH_POWER - 1e-9 &&
+              MIN_SMOOTH_POWER + (NUM_CURVE_PRESETS - 1) * smooth_power_step < MAX_SMOOTH_POWER + 1e-9,
+              "the smooth_power steps must land on MAX_SMOOTH_POWER");
+
+// Compile-time math: ln() by halving into [0.5, 1] plus the atanh series,
+// exp() by squaring from a short Taylor series.
+constexpr double LN2 = 0.693147180559945309;
+constexpr double ct_atanh_series(double z2, double zk, int k) {
+    return k > 41 ? 0. : zk / k + ct_atanh_series(z2, zk * z2, k + 2);
+}
+constexpr double ct_atanh(double z) { return ct_atanh_series(z * z, z, 1); }
+constexpr double ct_ln(double x) {
+    return x < 0.5 ? ct_ln(2. * x) - LN2 : 2. * ct_atanh((x - 1.) / (x + 1.));
+}
+constexpr double ct_exp_taylor(double y, double term, int k) {
+    return k > 20 ? term : term + ct_exp_taylor(y, term * y / k, k + 1);
+}
+constexpr double ct_square(double x) { return x * x; }
+constexpr double ct_exp(double y) {
+    return (y < -0.25 || y > 0.25) ? ct_square(ct_exp(y / 2.)) : ct_exp_taylor(y, 1., 1);
+}
+constexpr float curve_point(int i, int preset) {
+    return i == 0 ? 0.f
+                  : (float)ct_exp((1. + MIN_SMOOTH_POWER + preset * smooth_power_step) * ct_ln((double)i / CURVE_STEPS));
+}
+
+// index_list<0, 1, ..., N-1>, built by doubling to keep template depth low
+template <int... Is> struct index_list {};
+template <class L, int H, bool Odd> struct double_index_list;
+template <int... Is, int H> struct double_index_list<index_list<Is...>, H, false> {
+    typedef index_list<Is..., (H + Is)...> type;
+};
+template <int... Is, int H> struct double_index_list<index_list<Is...>, H, true> {
+    typedef index_list<Is..., (H + Is)..., 2 * H> type;
+};
+template <int N> struct make_index_list {
+    typedef typename double_index_list<typename make_index_list<N / 2>::type, N / 2, N % 2 == 1>::type type;
+};
+template <> struct make_index_list<0> { typedef index_list<> type; };
+
+struct CurveTable { float v[CURVE_STEPS + 1]; };
+
+template <int... Is> constexpr CurveTable make_curve_table(int preset, index_list<Is...>) {
+    return CurveTable{{ curve_point(Is, preset)... }};
+}
+// One constant per preset, so each table is a separate (smaller) compile-time evaluation
+template <int P> struct CurvePreset {
+    static constexpr CurveTable table = make_curve_table(P, make_index_list<CURVE_STEPS + 1>::type());
+};
+template <int P> constexpr CurveTable CurvePreset<P>::table;
+
+template <int... Ps> struct CurvePresetList {
+    static const float *const table[sizeof...(Ps)];
+};
+template <int... Ps> const float *const CurvePresetList<Ps...>::table[sizeof...(Ps)] = { CurvePreset<Ps>::table.v... };
+
+template <class L> struct CurvePresetsOf;
+template <int... Ps> struct CurvePresetsOf<index_list<Ps...> > { typedef CurvePresetList<Ps...> type; };
+typedef CurvePresetsOf<make_index_list<NUM_CURVE_PRESETS>::type>::type curve_presets;
+
+static int curve_preset = 26;  // smooth_power = 0.55
+static double smooth_power = MIN_SMOOTH_POWER + curve_preset * smooth_power_step;
+static const float *curve_table = curve_presets::table[curve_preset];
 
 double scale_joystick(double input)  // input positive between 0 and ~ 1
 {
-    // result ~= input^(1+smooth_power), modulo dead zone
-	double result;
-	if (input > DEADZONE) {
-		result = fmin((input - DEADZONE) / (1.0 - DEADZONE), 1.0);
-		result *= pow(result, smooth_power);  // fine control, optional
-	}
-    else {
-        return 0.;
-    }
-	return result;
+    if (input <= DEADZONE) return 0.;
+    if (input >= 1.0) return curve_table[CURVE_STEPS];
+    // linear interpolation between the two nearest table entries
+    double x = (input - DEADZONE) / (1.0 - DEADZONE) * CURVE_STEPS;
+    int i = (int)x;
+    return curve_table[i] + (curve_table[i + 1] - curve_table[i]) * (x - i);
+}
+
+void set_curve_preset(int preset) {
+    curve_preset = preset < 0 ? 0 : (preset >= NUM_CURVE_PRESETS ? NUM_CURVE_PRESETS - 1 : preset);
+    smooth_power = MIN_SMOOTH_POWER + curve_preset * smooth_power_step;
+    curve_table = curve_presets::table[curve_preset];
 }
 
 void smooth_power_up() {
-    smooth_power += smooth_power_step;
-    smooth_power = fmin(smooth_power, MAX_SMOOTH_POWER);
+    set_curve_preset(curve_preset + 1);
 }
 
 void smooth_power_down() {
-    smooth_power -= smooth_power_step;
-    smooth_power = fmax(smooth_power, MIN_SMOOTH_POWER);
+    set_curve_preset(curve_preset - 1);
 }
 
 // Whether to print drive info on controller screen
@@ -62,10 +132,65 @@ void toggle_print_info(){
 
 
 // Drive code
-motor lmotors[] {Motor11dl, Motor01dl, Motor03dl};
-motor rmotors[] {Motor04dr, Motor16dr, Motor02dr};
 const int NUM_MOTORS = 3; // per side
 
+/**
+ * Motors that are driven together, e.g. one side of the drive. Holds pointers to
+ * the motors declared in robot-config.h instead of copies, and applies each
+ * command or sensor read to the whole group in one call.
+ */
+class MotorGroup {
+public:
+    MotorGroup(motor &m1, motor &m2, motor &m3) : m{&m1, &m2, &m3} {}
+
+    motor &operator[](int i) { return *m[i]; }
+
+    void spin(directionType dir, double velocity, percentUnits units) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->spin(dir, velocity, units);
+    }
+
+    void stop() {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->stop();
+    }
+
+    void stop(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->stop(mode);
+    }
+
+    void setStopping(brakeType mode) {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->setStopping(mode);
+    }
+
+    void resetRotation() {
+        for (int i = 0; i < NUM_MOTORS; i++) m[i]->resetRotation();
+    }
+
+    // Averages over the group
+    double power() {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->power(powerUnits::watt);
+        return sum / NUM_MOTORS;
+    }
+
+    double velocity(velocityUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->velocity(units);
+        return sum / NUM_MOTORS;
+    }
+
+    double rotation(rotationUnits units) {
+        double sum = 0.;
+        for (int i = 0; i < NUM_MOTORS; i++) sum += m[i]->rotation(units);
+        return sum / NUM_MOTORS;
+    }
+
+private:
+    motor *m[NUM_MOTORS];
+};
+
+MotorGroup lmotors(Motor11dl, Motor01dl, Motor03dl);
+MotorGroup rmotors(Motor04dr, Motor16dr, Motor02dr);
+
 /**
  * Reversing of motors. If reversed is true then front and back of the robot are reversed.
  */
@@ -91,17 +216,13 @@ void print_motor_line() {
 }
 
 void spin_motors(double lp, double rp) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(vex::directionType::fwd, lp, percentUnits::pct);
-        rmotors[i].spin(vex::directionType::fwd, rp, percentUnits::pct);
-    }
+    lmotors.spin(vex::directionType::fwd, lp, percentUnits::pct);
+    rmotors.spin(vex::directionType::fwd, rp, percentUnits::pct);
 }
 
 void set_stopping_mode_for_motors(brakeType mode) {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].setStopping(mode);
-        rmotors[i].setStopping(mode);
-    }
+    lmotors.setStopping(mode);
+    rmotors.setStopping(mode);
 }
 
 void reverse_toggle() {
@@ -122,10 +243,8 @@ void stopping_mode_toggle() {
  * Stop all wheel motors 
  */
 void stopAllMotors() {
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].stop();
-        rmotors[i].stop();
-    }
+    lmotors.stop();
+    rmotors.stop();
 }
 
 void arcadedrive() {
@@ -227,10 +346,8 @@ int autonState = 1;
  */
 void moveStraight (int power=100, bool fwd=true, int time=1000) {
     vex::directionType dir = fwd ? vex::directionType::fwd : vex::directionType::rev;
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dir, power, percentUnits::pct);
-        rmotors[i].spin(dir, power, percentUnits::pct);
-    }
+    lmotors.spin(dir, power, percentUnits::pct);
+    rmotors.spin(dir, power, percentUnits::pct);
     
     task::sleep(time);
     set_stopping_mode_for_motors(hold);
@@ -259,10 +376,8 @@ void rotate(int angle) {
     vex::directionType dirL = angle < 0 ? vex::directionType::fwd : vex::directionType::rev;
     vex::directionType dirR = angle > 0 ? vex::directionType::fwd : vex::directionType::rev;
     
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        lmotors[i].spin(dirL, 100, percentUnits::pct);
-        rmotors[i].spin(dirR, 100, percentUnits::pct);
-    }
+    lmotors.spin(dirL, 100, percentUnits::pct);
+    rmotors.spin(dirR, 100, percentUnits::pct);
     /* Calculate time to rotate (Rotates at around 0.36 deg/ms) */
     int absAng = angle < 0 ? -angle : angle;
     int time = absAng / 9 * 25;
@@ -415,5 +530,6 @@ int main() {
     pre_auton();//setup
     Competition.autonomous(autonomous);
     Competition.drivercontrol(user_control);
+    return 0;
 }
 